@@ -0,0 +1,45 @@
+// Runs the allocator benchmark on the host against an mmapped region. Build with "make alloc-bench".
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "bench/AllocatorBench.h"
+
+static uint64_t now() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1'000'000'000ul + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+	constexpr size_t REGION_SIZE = 512ul << 20;
+	const size_t operations = 2 <= argc? strtoul(argv[1], nullptr, 10) : 1'000'000;
+	if (operations == 0) {
+		fprintf(stderr, "Usage: %s [operations]\n", argv[0]);
+		return 1;
+	}
+
+	void *region = mmap(nullptr, REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1,
+		0);
+	if (region == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	Armaz::Bench::AllocatorResult results[Armaz::Bench::ALLOCATOR_WORKLOADS];
+	Armaz::Bench::benchAllocator(static_cast<char *>(region), REGION_SIZE, operations, now, results);
+
+	printf("%-18s %10s %8s %12s %12s %7s\n", "workload", "ops", "ns/op", "peak live", "footprint", "frag");
+	for (const auto &result: results)
+		printf("%-18s %10lu %8.1f %12lu %12lu %7.3f\n", result.name, result.operations,
+			static_cast<double>(result.nanoseconds) / result.operations, result.peakLive, result.footprint,
+			result.fragmentation);
+
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("Peak RSS: %ld KiB\n", usage.ru_maxrss);
+	return 0;
+}
@@ -0,0 +1,109 @@
+// Checks the scratch arena on the host: alignment, scope rewinding, chunk growth, exhaustion and the STL adaptor.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Arena.h"
+
+using Armaz::Memory::Arena;
+using Armaz::Memory::ArenaAllocator;
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static void check(bool ok, const char *what, size_t a = 0, size_t b = 0) {
+	++checks;
+	if (!ok && failures++ < 20)
+		fprintf(stderr, "%s failed: %lu %lu\n", what, a, b);
+}
+
+static bool aligned(const void *ptr, size_t alignment) {
+	return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+static void testAlignment() {
+	Arena arena(4096);
+	for (size_t alignment = 1; alignment <= 8192; alignment <<= 1)
+		for (size_t size: {1ul, 3ul, 16ul, 100ul, 5000ul}) {
+			char *ptr = static_cast<char *>(arena.allocate(size, alignment));
+			check(ptr && aligned(ptr, alignment), "alignment", size, alignment);
+			if (ptr)
+				memset(ptr, 0xa5, size);
+		}
+
+	check(aligned(arena.allocate(1), alignof(max_align_t)), "default alignment");
+}
+
+static void testScopes() {
+	Arena arena(1024);
+	void *before = arena.allocate(8);
+	const size_t used = arena.getUsed();
+
+	{
+		Arena::Scope outer(arena);
+		void *first = arena.allocate(64);
+
+		{
+			Arena::Scope inner(arena);
+			// Enough to spill into new chunks, which the inner scope has to free.
+			for (int i = 0; i < 10; ++i)
+				check(arena.allocate(512) != nullptr, "inner allocation", i);
+		}
+
+		check(arena.allocate(64) == static_cast<char *>(first) + 64, "inner rewind");
+	}
+
+	check(arena.getUsed() == used, "outer rewind", arena.getUsed(), used);
+	check(arena.allocate(8) == static_cast<char *>(before) + 16, "allocation after rewind");
+
+	arena.reset();
+	check(arena.getUsed() == 0, "reset", arena.getUsed());
+	check(arena.allocate(8) == before, "allocation after reset");
+}
+
+static void testExhaustion() {
+	Arena arena(256);
+	check(arena.allocate(SIZE_MAX) == nullptr, "SIZE_MAX");
+	check(arena.allocate(SIZE_MAX - 8, 4096) == nullptr, "SIZE_MAX aligned");
+	check(arena.allocate(size_t(1) << 62) == nullptr, "huge");
+	// A failed allocation mustn't disturb the chunk in use.
+	void *ptr = arena.allocate(16);
+	check(ptr != nullptr, "after failure");
+	check(arena.allocate(16) == static_cast<char *>(ptr) + 16, "bump after failure");
+
+	// Requests bigger than the chunk size get a chunk of their own.
+	char *big = static_cast<char *>(arena.allocate(100'000));
+	check(big != nullptr, "oversized chunk");
+	if (big)
+		memset(big, 0, 100'000);
+}
+
+static void testVector() {
+	Arena arena(512);
+	{
+		Arena::Scope scope(arena);
+		std::vector<uint64_t, ArenaAllocator<uint64_t>> numbers {ArenaAllocator<uint64_t>(arena)};
+		for (uint64_t i = 0; i < 10'000; ++i)
+			numbers.push_back(i * 2654435761u % 10'007);
+		std::sort(numbers.begin(), numbers.end());
+		check(std::is_sorted(numbers.begin(), numbers.end()), "sorted vector");
+		check(numbers.size() == 10'000, "vector size", numbers.size());
+
+		std::vector<char, ArenaAllocator<char>> copy(numbers.get_allocator());
+		check(copy.get_allocator() == numbers.get_allocator(), "rebound allocator");
+	}
+	check(arena.getUsed() == 0, "vector scope", arena.getUsed());
+}
+
+int main() {
+	testAlignment();
+	testScopes();
+	testExhaustion();
+	testVector();
+	printf("%lu checks, %lu failures\n", checks, failures);
+	return failures? 1 : 0;
+}
@@ -0,0 +1,63 @@
+// Runs the mem* benchmark against the host's libc for comparison with "bench mem" on the Pi. Build with
+// "make mem-bench". Throughput is per TSC tick on x86-64, per CNTVCT tick on AArch64 and per nanosecond elsewhere.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "bench/MemoryBench.h"
+
+#if defined(__x86_64__)
+static const char *UNIT = "TSC tick";
+
+static uint64_t now() {
+	return __rdtsc();
+}
+#elif defined(__aarch64__)
+static const char *UNIT = "CNTVCT tick";
+
+static uint64_t now() {
+	uint64_t count;
+	asm volatile("isb; mrs %0, cntvct_el0" : "=r"(count));
+	return count;
+}
+#else
+static const char *UNIT = "ns";
+
+static uint64_t now() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1'000'000'000ul + ts.tv_nsec;
+}
+#endif
+
+static void report(const Armaz::Bench::MemoryRow &row) {
+	printf("%-8s %8lu", row.function, row.size);
+	for (const double bytes: row.bytesPerTick)
+		printf(" %8.2f", bytes);
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	const size_t max_size = 2 <= argc? strtoul(argv[1], nullptr, 10) : Armaz::Bench::MEMORY_MAX_SIZE;
+
+	void *region = mmap(nullptr, Armaz::Bench::MEMORY_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+		-1, 0);
+	if (region == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	printf("Bytes per %s at each source/destination alignment\n%-8s %8s", UNIT, "function", "size");
+	for (const auto &alignment: Armaz::Bench::memoryAlignments)
+		printf(" %5u/%-2u", alignment.source, alignment.destination);
+	printf("\n");
+
+	Armaz::Bench::benchMemory(static_cast<char *>(region), max_size, now, report);
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Differential test of the kernel's assembly string routines against the host's libc. This has to run on an AArch64
+// host; build it with a musl toolchain to compare against the same libc the kernel links, e.g.
+// "make string-test HOSTCXX=aarch64-linux-musl-g++". Strings are also placed against an inaccessible page to check
+// that nothing reads past the page holding the end of its input.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern "C" {
+	void * memmove_neon(void *, const void *, size_t);
+	int memcmp_word(const void *, const void *, size_t);
+	void * memchr_neon(const void *, int, size_t);
+	size_t strlen_neon(const char *);
+	int strcmp_word(const char *, const char *);
+	int strncmp_word(const char *, const char *, size_t);
+}
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static int sign(int value) {
+	return (0 < value) - (value < 0);
+}
+
+static void check(bool ok, const char *function, size_t a, size_t b, size_t c) {
+	++checks;
+	if (!ok && failures++ < 20)
+		fprintf(stderr, "%s mismatch: %lu %lu %lu\n", function, a, b, c);
+}
+
+static void fill(unsigned char *buffer, size_t size, int lowest, int count) {
+	for (size_t i = 0; i < size; ++i)
+		buffer[i] = lowest + rand() % count;
+}
+
+static void testMemmove(unsigned char *area, unsigned char *expected) {
+	constexpr size_t SPAN = 8192;
+	for (size_t n = 0; n < 1200; n += n < 300? 1 : 37) {
+		const long deltas[] {0, 1, -1, 15, -16, 17, -63, 64, 129, -129, static_cast<long>(n), -300};
+		for (long delta: deltas) {
+			const size_t src = 2048 + rand() % 16;
+			const size_t dst = src + delta;
+			fill(area, SPAN, 0, 256);
+			memcpy(expected, area, SPAN);
+			memmove(expected + dst, expected + src, n);
+			check(memmove_neon(area + dst, area + src, n) == area + dst, "memmove", n, src, dst);
+			check(memcmp(area, expected, SPAN) == 0, "memmove", n, src, dst);
+		}
+	}
+}
+
+static void testMemcmp(unsigned char *left, unsigned char *right, unsigned char *page_end) {
+	for (size_t n = 0; n < 1200; n += n < 200? 1 : 29)
+		for (int trial = 0; trial < 16; ++trial) {
+			unsigned char *l = left + rand() % 16;
+			unsigned char *r = trial % 2? page_end - n : right + rand() % 16;
+			fill(l, n, 0, 256);
+			memcpy(r, l, n);
+			if (n && trial % 4)
+				r[rand() % n] = rand();
+			check(sign(memcmp_word(l, r, n)) == sign(memcmp(l, r, n)), "memcmp", n, l - left, trial);
+		}
+}
+
+static void testMemchr(unsigned char *buffer, unsigned char *page_end) {
+	const int chars[] {0, 3, 7, 9, 0x103};
+	for (size_t n = 0; n < 1200; n += n < 200? 1 : 29)
+		for (int trial = 0; trial < 8; ++trial) {
+			unsigned char *s = trial % 2? page_end - n : buffer + rand() % 16;
+			fill(s, n, 0, 8);
+			for (int c: chars)
+				check(memchr_neon(s, c, n) == memchr(s, c, n), "memchr", n, trial, c);
+		}
+	buffer[100] = 42;
+	check(memchr_neon(buffer + 3, 42, SIZE_MAX) == buffer + 100, "memchr", SIZE_MAX, 3, 42);
+}
+
+static void testStrings(unsigned char *left, unsigned char *right, unsigned char *page_end) {
+	for (size_t n = 0; n < 600; n += n < 100? 1 : 13)
+		for (int trial = 0; trial < 20; ++trial) {
+			char *l = reinterpret_cast<char *>(trial % 3 == 0? page_end - n - 1 : left + rand() % 64);
+			char *r = reinterpret_cast<char *>(trial % 3 == 1? page_end - n - 1 : right + rand() % 64);
+			fill(reinterpret_cast<unsigned char *>(l), n, 1, 255);
+			l[n] = '\0';
+			memcpy(r, l, n + 1);
+			if (n && trial % 4 == 1)
+				r[rand() % n] = 1 + rand() % 255;
+			else if (n && trial % 4 == 2)
+				r[rand() % n] = '\0';
+			else if (n && trial % 4 == 3)
+				l[rand() % n] |= 0x80;
+
+			const size_t limits[] {0, 1, 7, 8, 9, 16, n, n + 1, SIZE_MAX};
+
+			check(strlen_neon(l) == strlen(l), "strlen", n, trial, 0);
+			check(sign(strcmp_word(l, r)) == sign(strcmp(l, r)), "strcmp", n, trial, 0);
+			for (size_t limit: limits)
+				check(sign(strncmp_word(l, r, limit)) == sign(strncmp(l, r, limit)), "strncmp", n, trial, limit);
+		}
+}
+
+int main() {
+	const size_t page = sysconf(_SC_PAGESIZE);
+	constexpr size_t AREA_SIZE = 1 << 20;
+
+	// The last page of the mapping is made inaccessible so that inputs can end right before it.
+	unsigned char *area = static_cast<unsigned char *>(mmap(nullptr, AREA_SIZE + page, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (area == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	mprotect(area + AREA_SIZE, page, PROT_NONE);
+	unsigned char *page_end = area + AREA_SIZE;
+	unsigned char *left = area;
+	unsigned char *right = area + AREA_SIZE / 2;
+
+	srand(1);
+	testMemmove(left, right);
+	testMemcmp(left, right, page_end);
+	testMemchr(left, page_end);
+	testStrings(left, right, page_end);
+
+	printf("%lu checks, %lu failures\n", checks, failures);
+	return failures? 1 : 0;
+}
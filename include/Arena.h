@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Armaz::Memory {
+	/** A bump-pointer allocator for scratch memory that all dies at the same time. Individual allocations are never
+	 *  freed; instead, the arena is reset as a whole or a Scope rolls it back to where it stood when the scope began.
+	 *  Memory comes from malloc in chunks, and the first chunk is kept across resets. */
+	class Arena {
+		private:
+			struct alignas(alignof(max_align_t)) Chunk {
+				Chunk *previous;
+				/** The number of usable bytes after the header. */
+				size_t size;
+				char * data() { return reinterpret_cast<char *>(this + 1); }
+			};
+
+			Chunk *chunk = nullptr;
+			char *current = nullptr;
+			char *limit = nullptr;
+			size_t chunkSize;
+
+			void * allocateSlow(size_t size, size_t alignment);
+			/** Frees chunks from the newest one down to, but not including, the given one. */
+			void releaseUntil(Chunk *);
+
+		public:
+			static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+			/** Records the arena's position on construction and returns to it on destruction, freeing everything that
+			 *  was allocated in between. Scopes can be nested as long as they're destroyed in reverse order. */
+			class Scope {
+				private:
+					Arena &arena;
+					Chunk *chunk;
+					char *current;
+					char *limit;
+
+				public:
+					Scope(Arena &);
+					~Scope();
+
+					Scope(const Scope &) = delete;
+					Scope & operator=(const Scope &) = delete;
+			};
+
+			Arena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+			~Arena();
+
+			Arena(const Arena &) = delete;
+			Arena(Arena &&) = delete;
+
+			Arena & operator=(const Arena &) = delete;
+			Arena & operator=(Arena &&) = delete;
+
+			/** Alignments must be powers of two. Returns nullptr if a new chunk was needed and couldn't be allocated. */
+			inline void * allocate(size_t size, size_t alignment = alignof(max_align_t)) {
+				char *aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(current) + alignment - 1) &
+					~(alignment - 1));
+				if (current && aligned <= limit && size <= static_cast<size_t>(limit - aligned)) {
+					current = aligned + size;
+					return aligned;
+				}
+				return allocateSlow(size, alignment);
+			}
+
+			/** Frees every chunk but the first and rewinds to its start. */
+			void reset();
+			/** Returns the number of bytes in use in the newest chunk. */
+			size_t getUsed() const;
+	};
+
+	/** Lets standard containers allocate from an Arena. Deallocation is a no-op. */
+	template <typename T>
+	class ArenaAllocator {
+		public:
+			using value_type = T;
+
+			Arena *arena;
+
+			ArenaAllocator(Arena &arena_): arena(&arena_) {}
+
+			template <typename U>
+			ArenaAllocator(const ArenaAllocator<U> &other): arena(other.arena) {}
+
+			T * allocate(size_t count) {
+				return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+			}
+
+			void deallocate(T *, size_t) {}
+
+			template <typename U>
+			bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+
+			template <typename U>
+			bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+	};
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Armaz::Checksum {
+	/** The reflected polynomials for CRC-32 (as used by GPT, zlib and Ethernet) and CRC-32C (Castagnoli). */
+	constexpr uint32_t CRC32_POLYNOMIAL  = 0xedb88320;
+	constexpr uint32_t CRC32C_POLYNOMIAL = 0x82f63b78;
+
+	/** Computes a CRC-32. To checksum data in pieces, pass the result for the previous piece as the last argument.
+	 *  Uses the ARMv8 CRC instructions if they're available and a table otherwise. */
+	uint32_t crc32(const void *data, size_t size, uint32_t previous = 0);
+
+	/** Computes a CRC-32C, in the same way as crc32. */
+	uint32_t crc32c(const void *data, size_t size, uint32_t previous = 0);
+}
@@ -1,5 +1,5 @@
 #pragma once
 
-// #define ARM_ALLOW_MULTI_CORE
+#define ARM_ALLOW_MULTI_CORE
 // #define UART_USE_FIQ
 // #define HIGH_PERIPHERAL_MODE
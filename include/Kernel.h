@@ -1,6 +1,11 @@
 #pragma once
 
+namespace Armaz {
+	class Pager;
+}
+
 namespace Armaz::Kernel {
 	void __attribute__((noreturn)) panic(const char *fmt, ...);
 	void __attribute__((noreturn)) perish();
+	Pager & getPager();
 }
@@ -24,67 +24,219 @@ namespace Armaz::Memory {
 
 	constexpr size_t MEMORY_ALIGN = 32;
 
+	/** Requests at least this large are served as whole page runs instead of coming out of the byte heap. */
+	constexpr size_t PAGE_ALLOCATION_MIN = 4 * PAGE_SIZE;
+	/** The byte heap is carved out of the normal zone as a single run of up to 2^HEAP_ORDER pages (512 MiB). */
+	constexpr size_t HEAP_ORDER = 13;
+
 	uintptr_t getCoherentPage(unsigned slot);
 
+	/** Zeroes count whole pages. Once the MMU is on, this clears a cache line per DC ZVA instead of storing zeros. */
+	void zeroPages(void *, size_t count);
+
 	class Allocator {
 		public:
-			struct BlockMeta {
+			/** Padded to MEMORY_ALIGN so that blocks tile the heap without gaps and every payload stays aligned. Blocks are
+			 *  physically contiguous, so the next block starts right after this one's payload and prevSize (a boundary
+			 *  tag copied from the previous block's size) locates the previous one. */
+			struct alignas(MEMORY_ALIGN) BlockMeta {
 				size_t size;
-				BlockMeta *next;
+				size_t prevSize;
 				bool free;
 			};
 
+			/** Stored in the payload of a free block that belongs to one of the small size classes. */
+			struct FreeNode {
+				FreeNode *prev, *next;
+			};
+
+			/** Stored in the payload of a free block too large for the size classes. The nodes form a treap keyed by
+			 *  (size, address) whose priorities are derived from the node addresses. */
+			struct TreeNode {
+				TreeNode *left, *right;
+			};
+
+			/** Free blocks of up to SMALL_MAX bytes are kept in exact-size lists, one per multiple of MEMORY_ALIGN. */
+			static constexpr size_t SMALL_CLASSES = 16;
+			static constexpr size_t SMALL_MAX = SMALL_CLASSES * MEMORY_ALIGN;
+
+			/** Takes a size that's a nonzero multiple of MEMORY_ALIGN no larger than SMALL_MAX. */
+			static inline size_t classOf(size_t size) { return size / MEMORY_ALIGN - 1; }
+
+			/** Like classOf, but sizes above SMALL_MAX all map to the extra class SMALL_CLASSES. */
+			static inline size_t statClassOf(size_t size) { return size <= SMALL_MAX? classOf(size) : SMALL_CLASSES; }
+
+			/** Counters kept by the allocator itself. Requests served by the core caches never reach the allocator, so
+			 *  they only show up here when a cache refills or drains. */
+			struct Stats {
+				/** Indexed by statClassOf(size). */
+				size_t allocations[SMALL_CLASSES + 1];
+				size_t frees[SMALL_CLASSES + 1];
+				/** The highest value getAllocated() has reached. */
+				size_t peak;
+				/** Free-block searches and the number of bins or tree nodes they inspected. */
+				size_t searches;
+				size_t searchSteps;
+			};
+
 		private:
-			static constexpr size_t PAGE_LENGTH = 4096;
+			/** The granularity at which PROACTIVE_PAGING commits the heap as it grows. */
+			static constexpr size_t PAGE_LENGTH = PAGE_SIZE;
 
 			// size_t align;
 			size_t allocated = 0;
 			char *start, *high, *end;
 			BlockMeta *base = nullptr;
+			BlockMeta *tail = nullptr;
 			uintptr_t highestAllocated = 0;
 
+			FreeNode *bins[SMALL_CLASSES] = {};
+			/** Bit n is set if and only if bins[n] is nonempty. */
+			uint32_t binMap = 0;
+			TreeNode *tree = nullptr;
+			/** The total payload size of all free blocks. */
+			size_t freeBytes = 0;
+			Stats stats = {};
+
 			uintptr_t realign(uintptr_t);
-			BlockMeta * findFreeBlock(BlockMeta * &last, size_t);
-			BlockMeta * requestSpace(BlockMeta *last, size_t);
+			BlockMeta * findFreeBlock(size_t);
+			BlockMeta * requestSpace(size_t);
+			/** Moves the end of the heap, committing pages if necessary. Returns false if it would pass the upper bound. */
+			bool grow(char *new_end);
 			void split(BlockMeta &, size_t);
-			int merge();
+			BlockMeta * coalesce(BlockMeta &);
+			void * allocateAligned(size_t size, size_t alignment);
+			/** Adds to the allocated byte count and updates the peak. */
+			void countAllocated(size_t bytes);
+
+			void insertFree(BlockMeta &);
+			void removeFree(BlockMeta &);
+
+			static TreeNode * treeInsert(TreeNode *root, TreeNode *node);
+			static TreeNode * treeRemove(TreeNode *root, TreeNode *node);
+			static TreeNode * treeJoin(TreeNode *left, TreeNode *right);
+			static bool treeLess(const TreeNode *, const TreeNode *);
+			static uint64_t treePriority(const TreeNode *);
+
+			static inline BlockMeta * blockOf(void *node) { return reinterpret_cast<BlockMeta *>(node) - 1; }
+
+			/** Neither of these may be called on the last (for nextBlock) or first (for previousBlock) block. */
+			static inline BlockMeta * nextBlock(BlockMeta &block) {
+				return reinterpret_cast<BlockMeta *>(reinterpret_cast<char *>(&block + 1) + block.size);
+			}
+
+			static inline BlockMeta * previousBlock(BlockMeta &block) {
+				return reinterpret_cast<BlockMeta *>(reinterpret_cast<char *>(&block) - block.prevSize) - 1;
+			}
 
 		public:
 			Allocator(const Allocator &) = delete;
 			Allocator(Allocator &&) = delete;
 
-			Allocator(char *start_, char *high_);
+			/** Unless make_global is false, the new allocator becomes global_memory. */
+			Allocator(char *start_, char *high_, bool make_global = true);
 			Allocator();
 
 			Allocator & operator=(const Allocator &) = delete;
 			Allocator & operator=(Allocator &&) = delete;
 
+			/** Alignments of MEMORY_ALIGN or less are always satisfied. Larger ones must be powers of two. */
 			void * allocate(size_t size, size_t alignment = 0);
 			void free(void *);
+			/** Resizes a live block without moving it, either by shrinking it, by absorbing the free block after it or by
+			 *  stretching it if it's the last block on the heap. Returns false if the block can't be resized in place. */
+			bool tryExpand(void *, size_t);
 			void setBounds(char *new_start, char *new_high);
 			BlockMeta * getBlock(void *);
+			bool contains(const void *) const;
 			size_t getAllocated() const;
 			size_t getUnallocated() const;
+			/** Returns the number of bytes between the start of the heap and the highest address it may grow to. */
+			size_t getCapacity() const;
+			/** Returns the number of bytes between the start and the current end of the heap. */
+			size_t getReserved() const { return end - start; }
+			const Stats & getStats() const { return stats; }
+			size_t getFreeBytes() const { return freeBytes; }
+			/** Returns the payload size of the largest free block in O(log n). Space past the end of the heap that has
+			 *  never been handed out isn't counted. */
+			size_t getLargestFree() const;
+			/** Returns 1 - largest free block / total free, i.e. 0 when all free memory is in one block. */
+			double getFragmentation() const;
+	};
+
+	/** Blocks of up to Allocator::SMALL_MAX bytes are recycled through per-core caches so that the common case of
+	 *  malloc and free touches only state owned by the current core. Each cache refills from and drains to the global
+	 *  heap in batches while holding the heap lock. */
+	class CoreCache {
+		public:
+			static constexpr size_t BATCH = 16;
+			/** The most blocks a cache will hold per size class before draining a batch. */
+			static constexpr size_t LIMIT = 2 * BATCH;
+
+			struct Stats {
+				size_t hits = 0;
+				size_t misses = 0;
+				size_t refills = 0;
+				size_t drains = 0;
+			};
+
+			/** Returns nullptr if the size isn't cached or if the global heap couldn't refill the cache. */
+			void * allocate(size_t);
+			/** Returns false if the block is too large to be cached, in which case the caller has to free it. */
+			bool free(void *);
+			/** Returns every cached block to the global heap. */
+			void drain();
+			const Stats & getStats() const { return stats; }
+			size_t getCachedBytes() const;
+
+		private:
+			struct Entry {
+				Entry *next;
+			};
+
+			Entry *heads[Allocator::SMALL_CLASSES] = {};
+			size_t counts[Allocator::SMALL_CLASSES] = {};
+			Stats stats;
+
+			void refill(size_t index);
+			void release(size_t index, size_t count);
 	};
+
+	CoreCache & getCoreCache();
+	CoreCache & getCoreCache(unsigned core);
 }
 
+extern Armaz::Memory::Allocator *global_memory;
+
+// Host builds (such as the allocator benchmark) use the host's libc and operator new.
+#ifndef ARMAZ_HOST
 extern "C" {
 	void * malloc(size_t);
 	void * calloc(size_t, size_t);
+	void * realloc(void *, size_t);
 	void free(void *);
-	// int posix_memalign(void **memptr, size_t alignment, size_t size);
+	/** Resizes an allocation in place if possible. Returns false (leaving it untouched) if it would have to move. */
+	bool try_expand(void *, size_t);
+	void * aligned_alloc(size_t alignment, size_t size);
+	int posix_memalign(void **memptr, size_t alignment, size_t size);
 }
 
-extern Armaz::Memory::Allocator *global_memory;
+namespace std {
+	enum class align_val_t: size_t;
+}
 
 #define MEMORY_OPERATORS_SET
 #ifdef __clang__
 void * operator new(size_t size);
 void * operator new[](size_t size);
+void * operator new(size_t size, std::align_val_t);
+void * operator new[](size_t size, std::align_val_t);
 void * operator new(size_t, void *ptr);
 void * operator new[](size_t, void *ptr);
 void operator delete(void *ptr)   noexcept;
 void operator delete[](void *ptr) noexcept;
+void operator delete(void *ptr, std::align_val_t)   noexcept;
+void operator delete[](void *ptr, std::align_val_t) noexcept;
 void operator delete(void *, void *)   noexcept;
 void operator delete[](void *, void *) noexcept;
 void operator delete(void *, unsigned long)   noexcept;
@@ -93,10 +245,18 @@ void operator delete[](void *, unsigned long) noexcept;
 #ifndef __cpp_exceptions
 inline void * operator new(size_t size)   throw() { return malloc(size); }
 inline void * operator new[](size_t size) throw() { return malloc(size); }
+inline void * operator new(size_t size, std::align_val_t alignment)   throw() {
+	return aligned_alloc(static_cast<size_t>(alignment), size);
+}
+inline void * operator new[](size_t size, std::align_val_t alignment) throw() {
+	return aligned_alloc(static_cast<size_t>(alignment), size);
+}
 inline void * operator new(size_t, void *ptr)   throw() { return ptr; }
 inline void * operator new[](size_t, void *ptr) throw() { return ptr; }
 inline void operator delete(void *ptr)   throw() { free(ptr); }
 inline void operator delete[](void *ptr) throw() { free(ptr); }
+inline void operator delete(void *ptr, std::align_val_t)   throw() { free(ptr); }
+inline void operator delete[](void *ptr, std::align_val_t) throw() { free(ptr); }
 inline void operator delete(void *, void *)   throw() {}
 inline void operator delete[](void *, void *) throw() {}
 inline void operator delete(void *, unsigned long)   throw() {}
@@ -104,13 +264,22 @@ inline void operator delete[](void *, unsigned long) throw() {}
 #else
 inline void * operator new(size_t size)   { return malloc(size); }
 inline void * operator new[](size_t size) { return malloc(size); }
+inline void * operator new(size_t size, std::align_val_t alignment)   {
+	return aligned_alloc(static_cast<size_t>(alignment), size);
+}
+inline void * operator new[](size_t size, std::align_val_t alignment) {
+	return aligned_alloc(static_cast<size_t>(alignment), size);
+}
 inline void * operator new(size_t, void *ptr)   { return ptr; }
 inline void * operator new[](size_t, void *ptr) { return ptr; }
 inline void operator delete(void *ptr)   noexcept { free(ptr); }
 inline void operator delete[](void *ptr) noexcept { free(ptr); }
+inline void operator delete(void *ptr, std::align_val_t)   noexcept { free(ptr); }
+inline void operator delete[](void *ptr, std::align_val_t) noexcept { free(ptr); }
 inline void operator delete(void *, void *)   noexcept {}
 inline void operator delete[](void *, void *) noexcept {}
 inline void operator delete(void *, unsigned long)   noexcept {}
 inline void operator delete[](void *, unsigned long) noexcept {}
 #endif
-#endif
\ No newline at end of file
+#endif
+#endif // ARMAZ_HOST
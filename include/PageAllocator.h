@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aarch64/Spinlock.h"
+#include "pi/MemoryMap.h"
+
+namespace Armaz::Memory {
+	/** A binary buddy allocator for runs of PAGE_SIZE pages. A run of 2^order pages is always aligned to its own size,
+	 *  so splitting a run or merging it with its buddy takes O(log n). */
+	class PageAllocator {
+		public:
+			/** The largest run is 2^MAX_ORDER pages (1 GiB). */
+			static constexpr size_t MAX_ORDER = 14;
+
+			PageAllocator(const PageAllocator &) = delete;
+			PageAllocator(PageAllocator &&) = delete;
+
+			PageAllocator() = default;
+
+			PageAllocator & operator=(const PageAllocator &) = delete;
+			PageAllocator & operator=(PageAllocator &&) = delete;
+
+			/** Takes ownership of the pages in [start_, end_). The page states are stored at the bottom of the range. */
+			void init(uintptr_t start_, uintptr_t end_);
+			/** Returns a run of 2^order pages or nullptr if no run that large is free. */
+			void * allocate(size_t order);
+			void * allocateBytes(size_t);
+			void free(void *);
+			bool contains(const void *) const;
+			/** Returns the size in bytes of the run beginning at a pointer returned by allocate. */
+			size_t getSize(const void *) const;
+			size_t getFreePages() const { return freePages; }
+			size_t getTotalPages() const { return (end - start) / PAGE_SIZE; }
+			/** Returns the smallest order whose runs are at least the given number of bytes long, or MAX_ORDER + 1 if
+			 *  even the largest run is too short. */
+			static size_t orderFor(size_t bytes);
+
+		private:
+			struct FreeNode {
+				FreeNode *prev, *next;
+			};
+
+			/** Marks the first page of a free run. */
+			static constexpr uint8_t FREE = 0x80;
+			/** Marks the first page of an allocated run. */
+			static constexpr uint8_t USED = 0x40;
+			static constexpr uint8_t ORDER_MASK = 0x1f;
+
+			/** Runs are aligned relative to base, which is aligned to the largest run size. */
+			uintptr_t base = 0, start = 0, end = 0;
+			size_t pageCount = 0;
+			/** One byte per page from base to end. */
+			uint8_t *states = nullptr;
+			FreeNode *lists[MAX_ORDER + 1] = {};
+			size_t freePages = 0;
+			TicketLock lock {Level::IRQ, "pages"};
+
+			void push(size_t index, size_t order);
+			void remove(size_t index, size_t order);
+
+			inline uintptr_t addressOf(size_t index) const { return base + index * PAGE_SIZE; }
+			inline size_t indexOf(uintptr_t address) const { return (address - base) / PAGE_SIZE; }
+	};
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aarch64/MMU.h"
+#include "aarch64/Spinlock.h"
+#include "pi/MemoryMap.h"
+
+namespace Armaz {
+	/** Hands out ranges of virtual address space above everything the identity map covers and backs them with RAM
+	 *  only once they're touched. A translation fault inside a reservation maps a zeroed page there and retries the
+	 *  access; a fault anywhere else is still fatal. Each reservation is followed by an unreserved guard page.
+	 *
+	 *  Reserved memory is paged in from the synchronous exception handler, which takes the page allocator's lock, so
+	 *  it mustn't be touched for the first time while that lock is held. */
+	class Pager {
+		public:
+			static constexpr uintptr_t WINDOW_START = 32 * GIGABYTE;
+			static constexpr uintptr_t WINDOW_END   = 1ul << MMU::ADDRESS_BITS;
+			static constexpr size_t MAX_RESERVATIONS = 64;
+
+			/** Reserves at least bytes bytes of address space. Returns nullptr if the window or the reservation table
+			 *  is full. */
+			void * reserve(size_t bytes);
+			/** Unmaps and frees every page backing a reservation and forgets it. The address space isn't reused. */
+			bool release(void *);
+			/** Backs the page holding an address right away. Returns true if it's already mapped, which includes all
+			 *  identity-mapped RAM, and false if it's outside every reservation or if no page could be allocated. */
+			bool assignAddress(void *);
+			/** Called on a translation fault at address. Returns true if the access can be retried. */
+			bool handleFault(uintptr_t address);
+
+			size_t getReservedBytes() const { return reservedBytes; }
+			size_t getCommittedPages() const { return committedPages; }
+			size_t getFaults() const { return faults; }
+
+		private:
+			struct Reservation {
+				uintptr_t start = 0;
+				uintptr_t end = 0;
+			};
+
+			Spinlock lock;
+			Reservation reservations[MAX_RESERVATIONS];
+			uintptr_t next = WINDOW_START;
+			size_t reservedBytes = 0;
+			size_t committedPages = 0;
+			size_t faults = 0;
+
+			const Reservation * findReservation(uintptr_t address) const;
+			/** Maps a zeroed page at the page-aligned address. The lock has to be held. */
+			bool commit(uintptr_t page);
+	};
+
+	static_assert(MEM_PCIE_RANGE_START + MEM_PCIE_RANGE_SIZE <= Pager::WINDOW_START,
+		"The pager's window has to be clear of the identity map");
+}
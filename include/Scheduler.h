@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aarch64/Spinlock.h"
+#include "aarch64/Timer.h"
+#include "pi/MemoryMap.h"
+
+namespace Armaz {
+	/** The vector registers of a thread that doesn't own them. The layout is known to context.S. */
+	struct alignas(16) FPState {
+		__uint128_t q[32] {};
+		uint64_t fpcr = 0;
+		uint64_t fpsr = 0;
+	};
+
+	/** What switchContext keeps for a thread that isn't running: the registers a call preserves, the stack pointer and
+	 *  the thread's vector register area. The layout is known to context.S. */
+	struct Context {
+		uint64_t x19 = 0, x20 = 0, x21 = 0, x22 = 0, x23 = 0, x24 = 0, x25 = 0, x26 = 0, x27 = 0, x28 = 0;
+		uint64_t x29 = 0, x30 = 0;
+		uint64_t sp = 0;
+		FPState *fp = nullptr;
+	};
+
+	/** Saves the calling thread's callee-saved registers into from and resumes the thread whose context is to. The
+	 *  vector registers are left alone: FP/SIMD access is turned off unless to already owns them, and the first
+	 *  instruction that uses them traps to the synchronous stub, which saves them for their owner and loads to's. */
+	void switchContext(Context *from, Context *to);
+
+	class Thread {
+		public:
+			enum class State {Ready, Running, Sleeping, Finished};
+			using Function = void (*)(void *);
+
+			/** Wraps the code already running on a core, which keeps the stack it has. */
+			Thread(const char *name_);
+			/** A thread that starts at function(argument) on the given stack once it's first scheduled. */
+			Thread(const char *name_, Function, void *argument_, void *stack_, size_t stack_size);
+			Thread(const Thread &) = delete;
+			Thread(Thread &&) = delete;
+
+			const char * getName() const { return name; }
+			State getState() const { return state; }
+
+		private:
+			friend class Scheduler;
+
+			Context context;
+			FPState fpState;
+			const char *name;
+			Function function = nullptr;
+			void *argument = nullptr;
+			void *stack = nullptr;
+			State state = State::Ready;
+			/** When a sleeping thread becomes ready, in Timers::getMicroseconds time. */
+			uint64_t wakeTime = 0;
+			/** Fires at wakeTime so that the core notices even if it's idle. */
+			Timers::Event wakeEvent;
+			/** The next thread in whichever of the scheduler's lists this one is on. */
+			Thread *next = nullptr;
+	};
+
+	/** Runs kernel threads round-robin, one scheduler per core. Threads stay on the core they were spawned on. A
+	 *  thread gives up its core by yielding, sleeping or returning; otherwise the timer tick takes the core away once
+	 *  another thread is ready, by making the IRQ stub return into the preemption trampoline instead of the
+	 *  interrupted code.
+	 *
+	 *  Before init is called on a core, yield does nothing there and sleep busy-waits, so code that might run before
+	 *  the scheduler can call them anyway. */
+	class Scheduler {
+		public:
+			/** The size of each spawned thread's stack. */
+			static constexpr size_t STACK_SIZE = PAGE_SIZE;
+
+			/** Returns the calling core's scheduler. */
+			static Scheduler * get();
+			static Scheduler * get(unsigned core);
+
+			/** Turns the code running on the calling core into its first thread and starts scheduling there. Has to
+			 *  be called on the core the scheduler belongs to. */
+			bool init();
+			bool isRunning() const { return running; }
+
+			/** Creates a thread on this scheduler's core. Returns false if its stack couldn't be allocated. The
+			 *  thread is freed once its function returns. */
+			bool spawn(const char *name, Thread::Function, void *argument);
+
+			/** Lets every other ready thread on this core run before the calling one continues. Returns false right
+			 *  away if no other thread was ready. */
+			bool yield();
+			/** Blocks the calling thread for at least the given time. The core runs other threads or idles in the
+			 *  meantime. */
+			void sleep(uint64_t microseconds);
+			/** Ends the calling thread. */
+			void __attribute__((noreturn)) exit();
+
+			/** Called by the timer tick and by sleepers' wake events: wakes the sleepers that are due and asks for a
+			 *  switch if a thread is waiting for the core. */
+			void tick();
+			/** Makes the next IRQ return on this core switch threads. */
+			void requestReschedule() { needReschedule = true; }
+
+			Thread * getCurrent() const { return current; }
+			size_t getThreadCount() const { return threadCount; }
+			uint64_t getSwitches() const { return switches; }
+
+			/** Called by the IRQ stub with the interrupted SPSR. */
+			static bool shouldPreempt(uint64_t spsr);
+			/** Called by the preemption trampoline with IRQs masked. */
+			static void preempt();
+			/** Where a new thread starts: the first switch to it returns here. */
+			static void __attribute__((noreturn)) runCurrent();
+
+		private:
+			/** Only ever taken with IRQs masked, since the tick takes it from the IRQ handler. */
+			TicketLock lock {Level::Task};
+			Thread *current = nullptr;
+			Thread *readyHead = nullptr;
+			Thread *readyTail = nullptr;
+			/** Sorted by wake time. */
+			Thread *sleeping = nullptr;
+			/** Finished threads whose stacks can be freed once another thread is running. */
+			Thread *zombies = nullptr;
+			size_t threadCount = 0;
+			uint64_t switches = 0;
+			bool running = false;
+			bool needReschedule = false;
+			/** Set while schedule is deciding or idling, which mustn't be preempted. */
+			bool inSchedule = false;
+
+			unsigned getCore() const;
+			void pushReady(Thread *);
+			Thread * popReady();
+			void wakeSleepers(uint64_t now);
+			/** Picks the next thread and switches to it, requeueing the current one if it's still running. Has to
+			 *  be called with IRQs masked. */
+			void schedule();
+			/** Frees the finished threads. The calling thread can't be one of them. */
+			void reap();
+	};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "pi/MemoryMap.h"
+
+namespace Armaz::Tasks {
+	/** How many queued tasks each core's deque holds. Spawning onto a full deque runs the task right away. */
+	constexpr size_t DEQUE_CAPACITY = 256;
+	/** The most pieces parallelFor splits a range into. */
+	constexpr size_t MAX_CHUNKS = 4 * CORES;
+
+	/** A unit of work and its join handle. The task has to stay alive until it's been joined. */
+	class Task {
+		public:
+			using Function = void (*)(void *);
+
+			Task() = default;
+			Task(Function function_, void *argument_): function(function_), argument(argument_) {}
+
+			bool isDone() const { return __atomic_load_n(&done, __ATOMIC_ACQUIRE); }
+			/** Runs other queued tasks until this one has finished. */
+			void join();
+
+		private:
+			friend void spawn(Task &);
+			friend bool runOne();
+
+			Function function = nullptr;
+			void *argument = nullptr;
+			bool done = false;
+
+			void run();
+	};
+
+	/** Queues a task on the calling core, where it's run by whoever joins it or by an idle core that steals it. */
+	void spawn(Task &);
+
+	/** Runs one queued task: the calling core's most recently spawned one or else the oldest from another core.
+	 *  Returns false if every deque was empty. */
+	bool runOne();
+
+	using RangeFunction = void (*)(size_t begin, size_t end, void *argument);
+
+	/** Splits [begin, end) into pieces of at least grain elements (at most MAX_CHUNKS of them), runs function on each
+	 *  across the cores and returns once they've all finished. The calling core runs the first piece itself. */
+	void parallelFor(size_t begin, size_t end, RangeFunction, void *argument, size_t grain = 1);
+
+	template <typename F>
+	void parallelFor(size_t begin, size_t end, F &&function, size_t grain = 1) {
+		using Callable = std::remove_reference_t<F>;
+		parallelFor(begin, end, [](size_t piece_begin, size_t piece_end, void *argument) {
+			(*static_cast<Callable *>(argument))(piece_begin, piece_end);
+		}, const_cast<std::remove_const_t<Callable> *>(&function), grain);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PageAllocator.h"
+#include "aarch64/Synchronize.h"
+#include "pi/MemoryMap.h"
+
+namespace Armaz::Memory {
+	class Allocator;
+
+	/** DMA-zone memory can be handed to the DMA engines and the EMMC controller. Normal-zone memory is only for the
+	 *  CPU; requests for it fall back to the DMA zone if the normal zone is exhausted or missing. */
+	enum class Zone {DMA, Normal};
+
+	constexpr size_t ZONE_COUNT = 2;
+	/** The most disjoint physical ranges a single zone can span. */
+	constexpr size_t ZONE_RANGES = 2;
+
+	/** Memory at or above 3 GiB isn't safe to use for DMA. */
+	constexpr uintptr_t DMA_ZONE_END = MEM_HIGHMEM_END + 1;
+	/** RAM behind the peripherals (in low peripheral mode) up to 4 GiB is unusable. */
+	constexpr uintptr_t PERIPHERAL_HOLE_START = 0xfc000000ul;
+	constexpr uintptr_t PERIPHERAL_HOLE_END   = 4 * GIGABYTE;
+
+	/** The DMA zone's byte heap is a run of 2^DMA_HEAP_ORDER pages (16 MiB). */
+	constexpr size_t DMA_HEAP_ORDER = 8;
+	/** DMA buffers are padded to whole cache lines so that cache maintenance on them can't affect other data. */
+	constexpr size_t DMA_ALIGN = L1_DATA_CACHE_LINE_LENGTH;
+
+	/** Hands the RAM reported by the firmware (the ARM side of the VideoCore split plus everything the board
+	 *  revision says is installed above 1 GiB) to the zones, then carves the byte heaps out of them: heap from the
+	 *  normal zone and dma_heap from the DMA zone. */
+	bool initZones(Allocator &heap, Allocator &dma_heap);
+
+	/** Returns the end of installed RAM as decoded from the board revision. */
+	uintptr_t getRAMEnd();
+
+	/** Returns a run of 2^order pages or nullptr if the zone (and any zone it falls back to) is exhausted. */
+	void * allocatePages(size_t order, Zone = Zone::Normal);
+	void * allocatePageBytes(size_t bytes, Zone = Zone::Normal);
+	/** Returns the page allocator managing an address, or nullptr if it's outside every zone. */
+	PageAllocator * findPages(const void *);
+
+	/** Returns DMA-safe memory whose size and alignment are rounded up to DMA_ALIGN. Release it with free(). The
+	 *  memory is cached, so use cleanRange before a device reads from it and invalidateRange after one writes to it. */
+	void * allocateDMA(size_t size, size_t alignment = DMA_ALIGN);
+	Allocator * getDMAHeap();
+
+	size_t getFreePages(Zone);
+	size_t getTotalPages(Zone);
+	const char * zoneName(Zone);
+}
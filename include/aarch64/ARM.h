@@ -4,6 +4,8 @@
 
 #include <stdint.h>
 
+#include "pi/MemoryMap.h"
+
 namespace Armaz::ARM {
 	int getEL();
 	uint32_t getSctlr();
@@ -20,6 +22,12 @@ namespace Armaz::ARM {
 	void handleInvalid();
 	void delay(int32_t count);
 
+	inline unsigned getCore() {
+		uint64_t mpidr;
+		asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+		return mpidr & (CORES - 1);
+	}
+
 	constexpr uint32_t SCTLR_MMU_ENABLED = 1;
 
 	constexpr uint32_t SYSTEM_TIMER_IRQ_0 = 1 << 0;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "pi/MemoryMap.h"
+
+namespace Armaz::Cores {
+	/** armstub8 parks cores 1-3 in a wfe loop, each polling the 64-bit slot at SPIN_TABLE_BASE + 8 * core until it
+	 *  holds an entry point. */
+	constexpr uintptr_t SPIN_TABLE_BASE = 0xd8;
+	/** How long start waits for each secondary core to finish initializing. */
+	constexpr uint64_t START_TIMEOUT_US = 100'000;
+
+	using Work = void (*)(void *);
+
+	/** Enables the spinlocks, releases the secondary cores from the spin table and waits for each of them to come
+	 *  online. Exclusive accesses (and so the spinlocks) only work on cacheable memory, so nothing is started unless
+	 *  the MMU is on. Returns the number of cores online, including this one. */
+	unsigned start();
+
+	/** Brings up the calling secondary core (MMU, GIC CPU interface, timer and scheduler), then runs whatever work
+	 *  it's handed for good, stealing queued tasks and yielding to the core's threads in between. */
+	void __attribute__((noreturn)) runSecondary();
+
+	bool isOnline(unsigned core);
+	unsigned getOnlineCount();
+
+	/** Hands work to an online secondary core. Returns false if the core isn't online or is still busy with earlier
+	 *  work. */
+	bool run(unsigned core, Work, void *argument);
+	bool isIdle(unsigned core);
+}
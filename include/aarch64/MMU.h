@@ -2,6 +2,7 @@
 
 // Credit: https://github.com/rsta2/circle
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Armaz::MMU {
@@ -11,8 +12,68 @@ namespace Armaz::MMU {
 	constexpr uint32_t SCTLR_EL1_A   = 1 <<  1;
 	constexpr uint32_t SCTLR_EL1_M   = 1 <<  0;
 
+	// MAIR_EL1 attribute indices and the attributes stored at them.
+	constexpr unsigned ATTRINDX_NORMAL   = 0;
+	constexpr unsigned ATTRINDX_DEVICE   = 1;
+	constexpr unsigned ATTRINDX_COHERENT = 2;
+	constexpr uint64_t MAIR_NORMAL_WB    = 0xff; // Inner and outer write-back non-transient, read/write-allocate
+	constexpr uint64_t MAIR_DEVICE_NGNRE = 0x04;
+	constexpr uint64_t MAIR_NORMAL_NC    = 0x44; // Inner and outer non-cacheable
+	constexpr uint64_t MAIR_VALUE = MAIR_NORMAL_WB << (8 * ATTRINDX_NORMAL) | MAIR_DEVICE_NGNRE << (8 * ATTRINDX_DEVICE)
+		| MAIR_NORMAL_NC << (8 * ATTRINDX_COHERENT);
+
+	constexpr unsigned ATTRIB_AP_RW_EL1          = 0;
+	constexpr unsigned ATTRIB_SH_OUTER_SHAREABLE = 2;
+	constexpr unsigned ATTRIB_SH_INNER_SHAREABLE = 3;
+
+	/** Translation uses the 64 KiB granule, so a level 3 table maps 8192 pages of 64 KiB and a level 2 entry spans
+	 *  512 MiB. A 36-bit address space (enough for the PCIe window at 24 GiB) starts the walk at level 2. */
+	constexpr unsigned ADDRESS_BITS        = 36;
+	constexpr uint64_t TABLE_ENTRIES       = 8192;
+	constexpr uint64_t LEVEL3_PAGE_SIZE    = 0x10000;
+	constexpr uint64_t LEVEL2_BLOCK_SIZE   = LEVEL3_PAGE_SIZE * TABLE_ENTRIES;
+	constexpr uint64_t LEVEL2_ENTRIES_USED = (1ul << ADDRESS_BITS) / LEVEL2_BLOCK_SIZE;
+	/** With the 64 KiB granule, the contiguous bit lets 32 aligned level 3 pages (2 MiB) share one TLB entry. */
+	constexpr uint64_t CONTIGUOUS_PAGES    = 32;
+	constexpr uint64_t CONTIGUOUS_SIZE     = LEVEL3_PAGE_SIZE * CONTIGUOUS_PAGES;
+
+	constexpr uint64_t TCR_EL1_T0SZ       = 64 - ADDRESS_BITS;
+	constexpr uint64_t TCR_EL1_IRGN0_WBWA = 1 << 8;
+	constexpr uint64_t TCR_EL1_ORGN0_WBWA = 1 << 10;
+	constexpr uint64_t TCR_EL1_SH0_INNER  = 3 << 12;
+	constexpr uint64_t TCR_EL1_TG0_64KB   = 1 << 14;
+	constexpr uint64_t TCR_EL1_EPD1       = 1 << 23; // No walks through TTBR1_EL1
+	constexpr uint64_t TCR_EL1_IPS_64GB   = 1ul << 32;
+	constexpr uint64_t TCR_EL1_VALUE = TCR_EL1_T0SZ | TCR_EL1_IRGN0_WBWA | TCR_EL1_ORGN0_WBWA | TCR_EL1_SH0_INNER
+		| TCR_EL1_TG0_64KB | TCR_EL1_EPD1 | TCR_EL1_IPS_64GB;
+
+	/** Whether RAM is mapped as normal memory, which makes unaligned accesses (and the NEON string routines) safe. */
+	extern bool enabled;
+
+	struct MappingStats {
+		/** Level 2 entries mapped as 512 MiB blocks. */
+		size_t blocks = 0;
+		/** Level 2 entries pointing to a level 3 table. */
+		size_t tables = 0;
+		/** Runs of CONTIGUOUS_PAGES level 3 pages marked contiguous. */
+		size_t contiguousRuns = 0;
+		/** Level 3 pages mapped on their own. */
+		size_t pages = 0;
+	};
+
+	/** Builds the kernel's translation tables for RAM up to ram_end and enables the MMU and caches. Returns false if
+	 *  the tables couldn't be allocated, in which case everything stays uncached. */
+	bool init(uintptr_t ram_end);
+	/** Points the MMU at the tables built by init and turns it on. */
 	void enable();
 	void disable();
+	/** Describes how the kernel's tables map memory. Everything is zero before init. */
+	const MappingStats & getMappingStats();
+	/** Maps and unmaps single pages in the kernel's tables. See TranslationTable::mapPage and unmapPage. */
+	bool mapPage(uintptr_t virtual_address, uintptr_t physical_address);
+	uintptr_t unmapPage(uintptr_t virtual_address);
+	/** Returns whether a read from an address would translate without faulting. */
+	bool isMapped(uintptr_t address);
 
 	struct Level2TableDescriptor {
 		uint64_t value11     : 2,  // set to 3
@@ -52,6 +113,7 @@ namespace Armaz::MMU {
 		Level2TableDescriptor   table;
 		Level2BlockDescriptor   block;
 		Level2InvalidDescriptor invalid;
+		uint64_t value;
 	} __attribute__((packed));
 
 	struct Level3PageDescriptor {
@@ -76,9 +138,10 @@ namespace Armaz::MMU {
 		         ignored: 63;
 	} __attribute__((packed));
 
-	union Lavel3Descriptor {
+	union Level3Descriptor {
 		Level3PageDescriptor    page;
 		Level3InvalidDescriptor invalid;
+		uint64_t value;
 	} __attribute__((packed));
 
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Armaz::PMU {
+	constexpr uint64_t PMCR_E  = 1 << 0; // Enable all counters
+	constexpr uint64_t PMCR_C  = 1 << 2; // Reset the cycle counter
+	constexpr uint64_t PMCR_LC = 1 << 6; // Cycle counter overflows at 64 bits rather than 32
+
+	constexpr unsigned PMCR_N_SHIFT = 11; // Number of event counters
+	constexpr uint64_t PMCR_N_MASK  = 0x1f;
+
+	constexpr uint64_t PMCNTENSET_C = 1ul << 31;
+
+	// Common event numbers the Cortex-A72 implements.
+	constexpr uint16_t EVENT_L1I_TLB_REFILL = 0x02;
+	constexpr uint16_t EVENT_L1D_TLB_REFILL = 0x05;
+	constexpr uint16_t EVENT_L2D_TLB_REFILL = 0x2d;
+
+	/** Starts the cycle counter counting at EL1. Returns false if there's no architected PMU or if the counter doesn't
+	 *  advance, which can happen under QEMU. */
+	bool enableCycleCounter();
+
+	/** Returns how many event counters the PMU has, or 0 if there's no architected PMU. */
+	unsigned getEventCounterCount();
+
+	/** Resets event counter `counter` and starts it counting `event` at EL0 and EL1. Returns false if the counter
+	 *  doesn't exist. Event counters are 32 bits wide. */
+	bool startEventCounter(unsigned counter, uint16_t event);
+	void stopEventCounter(unsigned counter);
+	uint32_t readEventCounter(unsigned counter);
+
+	inline uint64_t getCycles() {
+		uint64_t cycles;
+		asm volatile("isb; mrs %0, pmccntr_el0" : "=r"(cycles));
+		return cycles;
+	}
+
+	inline uint64_t getVirtualCount() {
+		uint64_t count;
+		asm volatile("isb; mrs %0, cntvct_el0" : "=r"(count));
+		return count;
+	}
+
+	inline uint64_t getCounterFrequency() {
+		uint64_t frequency;
+		asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+		return frequency;
+	}
+}
@@ -20,9 +20,52 @@ namespace Armaz {
 #ifdef ARM_ALLOW_MULTI_CORE
 		public:
 			~Spinlock();
+			/** Until enable is called, there's only one core and locks only have to manage the interrupt mask. */
+			static bool isEnabled() { return enabled; }
 		private:
 			uint32_t locked = 0;
 			static bool enabled;
+#endif
+	};
+
+	/** A fair spinlock: cores get the lock in the order they asked for it and wait in wfe instead of hammering the
+	 *  lock's cache line. Levels work as they do for Spinlock. A named lock also counts how often it's taken, how often
+	 *  a core had to wait for it and for how long, and can be found through getFirst. */
+	class TicketLock {
+		public:
+			struct Stats {
+				uint64_t acquisitions = 0;
+				uint64_t contended = 0;
+				/** CNTVCT ticks spent waiting. */
+				uint64_t spinTicks = 0;
+			};
+
+			TicketLock(Level = Level::IRQ, const char *name_ = nullptr);
+			TicketLock(const TicketLock &) = delete;
+			TicketLock(TicketLock &&) = delete;
+
+			void acquire();
+			void release();
+
+			const char * getName() const { return name; }
+			const Stats & getStats() const { return stats; }
+			void resetStats();
+
+			/** Named locks are kept in a list, most recently constructed first. */
+			static TicketLock * getFirst() { return first; }
+			TicketLock * getNext() const { return next; }
+
+		private:
+			Level level;
+			const char *name;
+			TicketLock *next = nullptr;
+			Stats stats;
+			static TicketLock *first;
+
+#ifdef ARM_ALLOW_MULTI_CORE
+			/** The ticket the next core to arrive takes and the ticket being served. */
+			uint16_t nextTicket = 0;
+			uint16_t owner = 0;
 #endif
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 // Credit: https://github.com/rsta2/circle
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace Armaz {
@@ -25,6 +26,16 @@ namespace Armaz {
 #define dataSyncBarrier() asm volatile("dsb sy" ::: "memory")
 	void cleanDataCache();
 	void invalidateDataCache();
+
+	/** Returns the smallest data cache line size in bytes, as reported by CTR_EL0. */
+	size_t getDataCacheLineSize();
+	/** Writes any dirty lines overlapping a range back to memory, e.g. before a device reads from it. */
+	void cleanRange(const void *start, size_t size);
+	/** Discards the lines overlapping a range, e.g. before reading what a device wrote to it. Lines only partly
+	 *  covered by the range are cleaned first so that neighboring data isn't lost. */
+	void invalidateRange(const void *start, size_t size);
+	/** Writes back and then discards the lines overlapping a range. */
+	void cleanInvalidateRange(const void *start, size_t size);
 #define invalidateInstructionCache() asm volatile("ic iallu" ::: "memory")
 #define instructionSyncBarrier()     asm volatile("isb"      ::: "memory")
 	void syncDataAndInstructionCache();
@@ -17,9 +17,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "pi/MemoryMap.h"
+
 namespace Armaz::Timers {
-	/** When set to 1000, the timer seems to run at 18.5 Hz. This means that this value should be about 54 times the
-	 *  actual desired frequency. Probably has something to do with the clock's 54 MHz frequency. */
+	/** How often each core's scheduler tick runs. The tick is a periodic event on the timer wheel. */
 	constexpr unsigned HZ = 10;
 
 	constexpr unsigned CLOCKHZ = 1'000'000;
@@ -52,23 +53,93 @@ namespace Armaz::Timers {
 	uint64_t getSystemTimer();
 	void waitMicroseconds(size_t);
 	unsigned getClockTicks();
+	/** Reads the generic timer's frequency for getMicroseconds and the timer wheel. Has to be called on the boot core
+	 *  before the other cores are started. */
+	void initScales();
+	/** Microseconds counted by the generic timer, which every core shares. Timer wheel deadlines use this clock. */
+	uint64_t getMicroseconds();
+
+	/** A callback on a core's timer wheel. The caller owns the event and has to keep it alive until it has fired for
+	 *  the last time or been cancelled. */
+	class Event {
+		public:
+			using Callback = void (*)(void *argument);
+
+			bool isPending() const { return pending; }
+			uint64_t getDeadline() const { return deadline; }
 
-	class Timer {
 		private:
-			unsigned clockTicksPerHzTick;
-			bool connected = false;
-			// void tuneMsDelay();
-			// volatile unsigned ticks;
+			friend class Timer;
+
+			uint64_t deadline = 0;
+			/** 0 for a one-shot event. */
+			uint64_t period = 0;
+			Callback callback = nullptr;
+			void *argument = nullptr;
+			Event *previous = nullptr;
+			Event *next = nullptr;
+			uint8_t level = 0;
+			uint8_t slot = 0;
+			bool pending = false;
+	};
 
+	/** Runs events at microsecond deadlines using the calling core's EL1 physical timer. Its interrupt is a PPI, so
+	 *  every core has its own timer; everything here only affects the core that calls it, and callbacks run in that
+	 *  core's IRQ handler.
+	 *
+	 *  Pending events sit on a hierarchical wheel: level n has WHEEL_SLOTS slots of 64^n microseconds each. Adding or
+	 *  cancelling an event is O(1), and an event moves down at most once per level before it fires. Instead of
+	 *  ticking, the timer is programmed for the next time a slot comes due and is turned off when nothing is
+	 *  pending. */
+	class Timer {
 		public:
+			static constexpr unsigned WHEEL_LEVELS = 6;
+			static constexpr unsigned WHEEL_SLOT_BITS = 6;
+			static constexpr unsigned WHEEL_SLOTS = 1 << WHEEL_SLOT_BITS;
+			/** Deadlines further away than this (about 19 hours) are taken down from the top level more than once. */
+			static constexpr uint64_t WHEEL_RANGE = 1ul << (WHEEL_LEVELS * WHEEL_SLOT_BITS);
+
 			Timer() {}
+			/** Connects the interrupt for the calling core and starts the scheduler tick. */
 			void init(bool calibrate = false);
 			void handler();
+			/** Forwards to the current core's timer. */
 			static void handler(void *);
 			void disconnect();
+
+			/** Calls callback(argument) once getMicroseconds() reaches deadline, and then every period microseconds if
+			 *  period isn't 0. A deadline in the past fires on the next interrupt. Returns false if the event is
+			 *  already pending. */
+			bool add(Event &, uint64_t deadline, Event::Callback, void *argument, uint64_t period = 0);
+			/** Returns false if the event wasn't pending. Can be called from a callback, including the event's own. */
+			bool cancel(Event &);
+
+		private:
+			/** The level of the events taken off a slot that are being fired. */
+			static constexpr uint8_t FIRING = WHEEL_LEVELS;
+			static constexpr uint64_t NO_DEADLINE = ~0ul;
+
+			bool connected = false;
+			Event *wheel[WHEEL_LEVELS][WHEEL_SLOTS] {};
+			/** One bit per non-empty slot. */
+			uint64_t occupied[WHEEL_LEVELS] {};
+			Event *firing = nullptr;
+			/** Everything before this time has been expired. */
+			uint64_t wheelTime = 0;
+			Event tickEvent;
+
+			void insert(Event &);
+			void unlink(Event &);
+			/** Takes every event off a slot and returns them as a list. */
+			Event * takeSlot(unsigned level, unsigned slot);
+			/** When the next slot comes due: when its events fire, or move down a level. */
+			uint64_t nextDue() const;
+			void expire(uint64_t now);
+			void program();
 	};
 
-	extern Timer timer;
+	/** Returns the calling core's timer. */
+	Timer & getTimer();
 
 	constexpr ptrdiff_t TIMER_CS  = 0x3000;
 	constexpr ptrdiff_t TIMER_CLO = 0x3004;
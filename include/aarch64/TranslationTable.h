@@ -0,0 +1,62 @@
+#pragma once
+
+// Credit: https://github.com/rsta2/circle
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aarch64/MMU.h"
+
+namespace Armaz::MMU {
+	/** Identity-maps the physical address space: RAM as normal write-back memory, the coherent region as normal
+	 *  non-cacheable memory and the peripherals and PCIe window as Device-nGnRE. Only the kernel's text is
+	 *  executable. Anything else is left unmapped so that stray accesses fault. Tables are taken from the page
+	 *  allocator, so the zones have to be set up first.
+	 *
+	 *  Each 512 MiB region whose attributes are all the same is mapped by one level 2 block. The rest use level 3
+	 *  tables, where every aligned 2 MiB run of identical pages gets the contiguous bit. Anything that later changes a
+	 *  page inside such a run has to rewrite the whole run. */
+	class TranslationTable {
+		private:
+			enum class Kind {Unmapped, Normal, Coherent, Device};
+
+			uint64_t *level2 = nullptr;
+			uintptr_t ramEnd = 0;
+			uintptr_t textEnd = 0;
+			MappingStats stats;
+
+			Kind classify(uintptr_t address) const;
+			/** Whether every page in [start, end) would get the same kind and permissions. */
+			bool isUniform(uintptr_t start, uintptr_t end) const;
+			/** Level 2 blocks and level 3 pages keep their attributes in the same bits. */
+			template <typename D>
+			static void setAttributes(D &descriptor, Kind kind, bool executable);
+			uint64_t describeBlock(uintptr_t address) const;
+			uint64_t describePage(uintptr_t address) const;
+			void markContiguous(uint64_t *table);
+			/** Returns the level 3 entry for an address, creating an empty level 3 table if create is true and the
+			 *  level 2 entry is invalid. Returns nullptr if the address is covered by a block. */
+			uint64_t * findPage(uintptr_t address, bool create);
+			uint64_t * createLevel3(uintptr_t base);
+			void release();
+
+		public:
+			TranslationTable() = default;
+			TranslationTable(const TranslationTable &) = delete;
+			TranslationTable(TranslationTable &&) = delete;
+
+			bool init(uintptr_t ram_end);
+
+			/** Maps one page of normal, non-executable memory. Fails if the page is already mapped, if it's covered by
+			 *  a block or if a level 3 table couldn't be allocated. */
+			bool mapPage(uintptr_t virtual_address, uintptr_t physical_address);
+			/** Unmaps one page and invalidates it in every core's TLB. Returns the physical address it was mapped to,
+			 *  or 0 if it wasn't mapped by a page. */
+			uintptr_t unmapPage(uintptr_t virtual_address);
+
+			/** The value to load into TTBR0_EL1. */
+			uintptr_t getBase() const { return reinterpret_cast<uintptr_t>(level2); }
+
+			const MappingStats & getStats() const { return stats; }
+	};
+}
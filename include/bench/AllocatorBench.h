@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Armaz::Bench {
+	struct AllocatorResult {
+		const char *name;
+		/** Allocations and frees combined, including the ones that tear the workload down. */
+		size_t operations;
+		uint64_t nanoseconds;
+		/** The most bytes that were live at once, block headers included. */
+		size_t peakLive;
+		/** How far the heap had to grow, i.e. how much memory the workload kept resident. */
+		size_t footprint;
+		/** Sampled right before teardown. */
+		double fragmentation;
+	};
+
+	constexpr size_t ALLOCATOR_WORKLOADS = 4;
+
+	/** Runs each workload on a fresh Memory::Allocator over [region, region + size) and fills in one result per
+	 *  workload. now() has to return a timestamp in nanoseconds. */
+	void benchAllocator(char *region, size_t size, size_t operations, uint64_t (*now)(), AllocatorResult *results);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Armaz::Bench {
+	struct MemoryAlignment {
+		/** Offsets from a 64-byte boundary. */
+		unsigned source, destination;
+	};
+
+	constexpr size_t MEMORY_ALIGNMENTS = 4;
+	constexpr MemoryAlignment memoryAlignments[MEMORY_ALIGNMENTS] {{0, 0}, {0, 1}, {1, 0}, {13, 7}};
+
+	constexpr size_t MEMORY_MAX_SIZE = 1 << 20;
+	/** The smallest region benchMemory can be given. */
+	constexpr size_t MEMORY_REGION_SIZE = 2 * MEMORY_MAX_SIZE + 256;
+
+	struct MemoryRow {
+		const char *function;
+		size_t size;
+		/** Bytes processed per tick of the clock passed to benchMemory, one per entry in memoryAlignments. */
+		double bytesPerTick[MEMORY_ALIGNMENTS];
+	};
+
+	/** Times memcpy, memmove, memset and memcmp at every power-of-two size from 1 byte to max_size (which is capped at
+	 *  MEMORY_MAX_SIZE) and at every alignment, calling report once per function and size. memmove is timed on an
+	 *  overlapping move to a higher address and memcmp on equal buffers, as those are their slowest cases. region has
+	 *  to hold at least MEMORY_REGION_SIZE bytes and be 64-byte aligned. */
+	void benchMemory(char *region, size_t max_size, uint64_t (*now)(), void (*report)(const MemoryRow &));
+}
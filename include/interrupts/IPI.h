@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "aarch64/Cores.h"
+
+namespace Armaz::IPI {
+	/** Each message is sent as the GIC-400 software-generated interrupt with the same number. */
+	enum class Message: unsigned {
+		/** Asks a core to run the reschedule handler, if one is set. */
+		Reschedule = 0,
+		/** Asks a core to invalidate its whole TLB. */
+		TLBShootdown = 1,
+		/** Asks a core to run the function posted with call. */
+		Call = 2,
+		/** Stops a core for good. */
+		Halt = 3,
+	};
+
+	constexpr unsigned MESSAGES = 4;
+
+	void send(unsigned core, Message);
+	/** Sends a message to every core except the calling one. */
+	void broadcast(Message);
+
+	/** Called by the interrupt handler for SGIs. */
+	void handle(unsigned sgi);
+
+	void setRescheduleHandler(void (*)());
+
+	/** Runs function(argument) on another core from its IRQ handler, or directly if core is the calling core. If wait
+	 *  is true, returns once the function has finished. Don't wait with IRQs masked: a core that's calling this core
+	 *  at the same time would never get an answer. Returns false if the core isn't online. */
+	bool call(unsigned core, Cores::Work function, void *argument, bool wait = true);
+
+	/** Invalidates the whole TLB on every online core and waits until they've all done it. The page mapping
+	 *  functions already broadcast their invalidations, so this is only needed after changes made without them. */
+	void shootdownTLBs();
+}
@@ -49,6 +49,9 @@ namespace Armaz {
 		void SynchronousStub();
 		void SErrorStub();
 		void SecureMonitorHandler(uint32_t function, uint32_t param);
+		/** Called first for every synchronous exception taken from EL1. Returns true if the exception was resolved
+		 *  and the faulting instruction can be retried. */
+		bool SynchronousHandler(uint64_t esr, uint64_t far);
 		void ExceptionHandler(uint64_t exception, AbortFrame *frame);
 		void InterruptHandler();
 
@@ -56,7 +59,13 @@ namespace Armaz {
 		extern Handler handlers[72];
 		extern void *params[72];
 
+		/** Sets up the distributor and then core 0's CPU interface. */
 		void init();
+		/** Sets up the calling core's CPU interface and banked interrupts and unmasks IRQs and FIQs. */
+		void initCore();
+		/** Sends a software-generated interrupt to every core whose bit is set in cores. */
+		void sendSGI(unsigned sgi, unsigned cores);
+		void sendSGIToOthers(unsigned sgi);
 		void connect(unsigned irq, Handler, void *);
 		void enable(unsigned irq);
 		void disconnect(unsigned irq);
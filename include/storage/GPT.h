@@ -32,6 +32,20 @@ namespace Armaz::GPT {
 		uint32_t partitionCount;
 		uint32_t partitionEntrySize;
 		uint32_t partitionsCRC32;
+
+		/** "EFI PART" */
+		static constexpr uint64_t SIGNATURE = 0x5452415020494645;
+		/** The size of the fields above. A larger headerSize is allowed; the extra bytes are reserved but still
+		 *  covered by the CRC. */
+		static constexpr uint32_t MIN_SIZE = 92;
+		static constexpr uint32_t MAX_SIZE = 512;
+
+		/** Checks the signature, the size and the CRC of the header. The CRC covers headerSize bytes, so the whole
+		 *  sector the header was read from (up to MAX_SIZE bytes) has to be behind this. */
+		bool validate() const;
+		/** Checks the CRC of the partition entry array, which should be partitionCount * partitionEntrySize bytes
+		 *  long. */
+		bool validatePartitions(const void *entries) const;
 	};
 
 	struct PartitionEntry {
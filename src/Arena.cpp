@@ -0,0 +1,65 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Arena.h"
+
+namespace Armaz::Memory {
+	Arena::Arena(size_t chunk_size): chunkSize(chunk_size) {}
+
+	Arena::~Arena() {
+		releaseUntil(nullptr);
+	}
+
+	void * Arena::allocateSlow(size_t size, size_t alignment) {
+		// Chunk data is only aligned to alignof(max_align_t), so stricter alignments need room to be padded.
+		if (SIZE_MAX - sizeof(Chunk) - alignment < size)
+			return nullptr;
+		const size_t needed = size + (alignof(max_align_t) < alignment? alignment : 0);
+		const size_t new_size = chunkSize < needed? needed : chunkSize;
+
+		Chunk *new_chunk = static_cast<Chunk *>(malloc(sizeof(Chunk) + new_size));
+		if (!new_chunk)
+			return nullptr;
+
+		new_chunk->previous = chunk;
+		new_chunk->size = new_size;
+		chunk = new_chunk;
+		current = new_chunk->data();
+		limit = current + new_size;
+		return allocate(size, alignment);
+	}
+
+	void Arena::releaseUntil(Chunk *last) {
+		while (chunk != last) {
+			Chunk *previous = chunk->previous;
+			free(chunk);
+			chunk = previous;
+		}
+	}
+
+	void Arena::reset() {
+		if (!chunk)
+			return;
+
+		Chunk *first = chunk;
+		while (first->previous)
+			first = first->previous;
+
+		releaseUntil(first);
+		current = first->data();
+		limit = current + first->size;
+	}
+
+	size_t Arena::getUsed() const {
+		return chunk? current - chunk->data() : 0;
+	}
+
+	Arena::Scope::Scope(Arena &arena_): arena(arena_), chunk(arena_.chunk), current(arena_.current),
+	limit(arena_.limit) {}
+
+	Arena::Scope::~Scope() {
+		arena.releaseUntil(chunk);
+		arena.current = current;
+		arena.limit = limit;
+	}
+}
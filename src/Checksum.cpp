@@ -0,0 +1,144 @@
+#include "Checksum.h"
+
+namespace Armaz::Checksum {
+	namespace {
+		/** The number of bytes each of the three interleaved lanes covers per iteration. */
+		constexpr size_t LANE = 1024;
+
+		struct Tables {
+			/** The register after shifting each possible byte into an empty one. */
+			uint32_t bytes[256];
+			/** Multiplication by x^(8 * LANE) and x^(16 * LANE), which advances a register past one or two lanes' worth
+			 *  of zeros. Multiplication is linear, so it's done one byte of the register at a time. */
+			uint32_t shiftOne[4][256];
+			uint32_t shiftTwo[4][256];
+		};
+
+		/** Multiplies two polynomials modulo the given one. Everything is bit-reflected, so x^0 is the top bit. */
+		constexpr uint32_t multiply(uint32_t a, uint32_t b, uint32_t polynomial) {
+			uint32_t product = 0;
+			for (uint32_t mask = 1u << 31; mask; mask >>= 1) {
+				if (a & mask)
+					product ^= b;
+				b = b & 1? (b >> 1) ^ polynomial : b >> 1;
+			}
+			return product;
+		}
+
+		/** Returns x^n modulo the given polynomial. */
+		constexpr uint32_t power(size_t n, uint32_t polynomial) {
+			uint32_t result = 1u << 31, square = 1u << 30;
+			for (; n; n >>= 1) {
+				if (n & 1)
+					result = multiply(result, square, polynomial);
+				square = multiply(square, square, polynomial);
+			}
+			return result;
+		}
+
+		constexpr Tables makeTables(uint32_t polynomial) {
+			Tables tables {};
+
+			for (uint32_t byte = 0; byte < 256; ++byte) {
+				uint32_t crc = byte;
+				for (int i = 0; i < 8; ++i)
+					crc = crc & 1? (crc >> 1) ^ polynomial : crc >> 1;
+				tables.bytes[byte] = crc;
+			}
+
+			const uint32_t one = power(8 * LANE, polynomial);
+			const uint32_t two = power(16 * LANE, polynomial);
+			uint32_t one_bits[32] {}, two_bits[32] {};
+			for (int bit = 0; bit < 32; ++bit) {
+				one_bits[bit] = multiply(one, 1u << bit, polynomial);
+				two_bits[bit] = multiply(two, 1u << bit, polynomial);
+			}
+
+			for (int i = 0; i < 4; ++i)
+				for (uint32_t byte = 0; byte < 256; ++byte)
+					for (int bit = 0; bit < 8; ++bit)
+						if ((byte >> bit) & 1) {
+							tables.shiftOne[i][byte] ^= one_bits[8 * i + bit];
+							tables.shiftTwo[i][byte] ^= two_bits[8 * i + bit];
+						}
+
+			return tables;
+		}
+
+		constexpr Tables crc32Tables  = makeTables(CRC32_POLYNOMIAL);
+		constexpr Tables crc32cTables = makeTables(CRC32C_POLYNOMIAL);
+
+#ifdef __ARM_FEATURE_CRC32
+		inline uint32_t shift(const uint32_t (&table)[4][256], uint32_t crc) {
+			return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^ table[2][(crc >> 16) & 0xff] ^
+				table[3][crc >> 24];
+		}
+
+		template <bool C>
+		inline uint32_t updateByte(uint32_t crc, uint8_t byte) {
+			if constexpr (C)
+				asm("crc32cb %w0, %w0, %w1" : "+r"(crc) : "r"(byte));
+			else
+				asm("crc32b %w0, %w0, %w1" : "+r"(crc) : "r"(byte));
+			return crc;
+		}
+
+		template <bool C>
+		inline uint32_t updateWord(uint32_t crc, uint64_t word) {
+			if constexpr (C)
+				asm("crc32cx %w0, %w0, %x1" : "+r"(crc) : "r"(word));
+			else
+				asm("crc32x %w0, %w0, %x1" : "+r"(crc) : "r"(word));
+			return crc;
+		}
+
+		/** Each CRC instruction has to wait for the one before it, so large buffers are split into three lanes that
+		 *  are checksummed side by side. The first two lanes' registers are then shifted past the lanes after them
+		 *  and everything is XORed together. */
+		template <bool C>
+		uint32_t update(const Tables &tables, const uint8_t *bytes, size_t size, uint32_t crc) {
+			// Word loads have to be aligned while the MMU is off.
+			for (; size && reinterpret_cast<uintptr_t>(bytes) % 8; --size)
+				crc = updateByte<C>(crc, *bytes++);
+
+			const uint64_t *words = reinterpret_cast<const uint64_t *>(bytes);
+			constexpr size_t LANE_WORDS = LANE / 8;
+
+			for (; 3 * LANE <= size; size -= 3 * LANE) {
+				uint32_t crc1 = 0, crc2 = 0;
+				for (size_t i = 0; i < LANE_WORDS; ++i) {
+					crc  = updateWord<C>(crc,  words[i]);
+					crc1 = updateWord<C>(crc1, words[i + LANE_WORDS]);
+					crc2 = updateWord<C>(crc2, words[i + 2 * LANE_WORDS]);
+				}
+				crc = shift(tables.shiftTwo, crc) ^ shift(tables.shiftOne, crc1) ^ crc2;
+				words += 3 * LANE_WORDS;
+			}
+
+			for (; 8 <= size; size -= 8)
+				crc = updateWord<C>(crc, *words++);
+
+			bytes = reinterpret_cast<const uint8_t *>(words);
+			for (; size; --size)
+				crc = updateByte<C>(crc, *bytes++);
+
+			return crc;
+		}
+#else
+		template <bool>
+		uint32_t update(const Tables &tables, const uint8_t *bytes, size_t size, uint32_t crc) {
+			for (; size; --size)
+				crc = tables.bytes[(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+			return crc;
+		}
+#endif
+	}
+
+	uint32_t crc32(const void *data, size_t size, uint32_t previous) {
+		return ~update<false>(crc32Tables, static_cast<const uint8_t *>(data), size, ~previous);
+	}
+
+	uint32_t crc32c(const void *data, size_t size, uint32_t previous) {
+		return ~update<true>(crc32cTables, static_cast<const uint8_t *>(data), size, ~previous);
+	}
+}
@@ -1,4 +1,7 @@
 #include "Kernel.h"
+#include "aarch64/Cores.h"
+#include "interrupts/IPI.h"
+#include "interrupts/IRQ.h"
 #include "lib/printf.h"
 #include "pi/UART.h"
 
@@ -14,7 +17,10 @@ namespace Armaz::Kernel {
 	}
 
 	void __attribute__((noreturn)) perish() {
-		for (;;) // TODO: ensure all cores are halted
+		Interrupts::disableBoth();
+		if (1 < Cores::getOnlineCount())
+			IPI::broadcast(IPI::Message::Halt);
+		for (;;)
 			asm volatile("wfi");
 	}
 }
@@ -1,21 +1,39 @@
 // Credit: https://github.com/rsta2/circle/blob/master/lib/memory64.cpp
 
+#include <errno.h>
+
 #include "Memory.h"
+#include "Zone.h"
 #include "util.h"
+#include "aarch64/ARM.h"
+#include "aarch64/Spinlock.h"
+#include "aarch64/Synchronize.h"
 #include "lib/printf.h"
 
+#ifdef PROACTIVE_PAGING
+#include "Kernel.h"
+#include "Pager.h"
+#endif
+
 // #define DEBUG_ALLOCATION
 
 Armaz::Memory::Allocator *global_memory = nullptr;
 
 namespace Armaz::Memory {
+#ifndef ARMAZ_HOST
+	/** Guards global_memory. The per-core caches take it only while refilling or draining. */
+	static TicketLock heapLock {Level::IRQ, "heap"};
+	static CoreCache coreCaches[CORES];
+#endif
+
 	uintptr_t getCoherentPage(unsigned slot) {
 		return MEM_COHERENT_REGION + slot * PAGE_SIZE;
 	}
 
-	Allocator::Allocator(char *start_, char *high_): start(start_), high(high_), end(start_) {
+	Allocator::Allocator(char *start_, char *high_, bool make_global): start(start_), high(high_), end(start_) {
 		start = (char *) realign((uintptr_t) start);
-		global_memory = this;
+		if (make_global)
+			global_memory = this;
 		highestAllocated = reinterpret_cast<uintptr_t>(start_);
 	}
 
@@ -31,71 +49,150 @@ namespace Armaz::Memory {
 		return val;
 	}
 
-	Allocator::BlockMeta * Allocator::findFreeBlock(BlockMeta * &last, size_t size) {
+	Allocator::BlockMeta * Allocator::findFreeBlock(size_t size) {
 #ifdef DEBUG_ALLOCATION
-		printf("findFreeBlock(0x%lx, %lu)\n", last, size);
+		printf("findFreeBlock(%lu)\n", size);
 #endif
-		BlockMeta *current = base;
-		while (current && !(current->free && current->size >= size)) {
-			last = current;
-			current = current->next;
+		if (size <= SMALL_MAX) {
+			// Any nonempty bin at or above the requested class will do. The lowest one is found with a single ctz.
+			const uint32_t candidates = binMap >> classOf(size);
+			if (candidates) {
+				const size_t index = classOf(size) + __builtin_ctz(candidates);
+				++stats.searches;
+				++stats.searchSteps;
+				return blockOf(bins[index]);
+			}
 		}
-		return current;
+
+		// Best fit: the smallest tree node whose block is at least as large as the request.
+		++stats.searches;
+		TreeNode *best = nullptr;
+		for (TreeNode *node = tree; node;) {
+			++stats.searchSteps;
+			if (size <= blockOf(node)->size) {
+				best = node;
+				node = node->left;
+			} else
+				node = node->right;
+		}
+
+		return best? blockOf(best) : nullptr;
 	}
 
-	Allocator::BlockMeta * Allocator::requestSpace(BlockMeta *last, size_t size) {
+	Allocator::BlockMeta * Allocator::requestSpace(size_t size) {
 #ifdef DEBUG_ALLOCATION
-		printf("requestSpace(0x%lx, %lu)\n", last, size);
+		printf("requestSpace(%lu)\n", size);
 #endif
 		BlockMeta *block = (BlockMeta *) realign((uintptr_t) end);
 
-		if (last)
-			last->next = block;
+		if (!grow(reinterpret_cast<char *>(block + 1) + size))
+			return nullptr;
+
+		if (!tail)
+			base = block;
+
+		block->size = size;
+		block->prevSize = tail? tail->size : 0;
+		block->free = false;
+		tail = block;
+		return block;
+	}
+
+	bool Allocator::grow(char *new_end) {
+#ifdef DEBUG_ALLOCATION
+		printf("grow(0x%lx)\n", new_end);
+#endif
+		if (high < new_end - 1)
+			return false;
 
 #ifdef PROACTIVE_PAGING
 		auto &pager = Kernel::getPager();
-		while (highestAllocated <= (uintptr_t) block + size) {
-			pager.assignAddress(reinterpret_cast<void *>(highestAllocated));
-			highestAllocated += PAGE_LENGTH;
+		while (highestAllocated < (uintptr_t) new_end) {
+			if (!pager.assignAddress(reinterpret_cast<void *>(highestAllocated)))
+				return false;
+			highestAllocated = Util::downalign(highestAllocated, PAGE_LENGTH) + PAGE_LENGTH;
 		}
 #endif
 
-		block->size = size;
-		block->next = nullptr;
-		block->free = 0;
-
-		end = reinterpret_cast<char *>(block) + block->size + sizeof(BlockMeta) + 1;
-		return block;
+		end = new_end;
+		return true;
 	}
 
-	void * Allocator::allocate(size_t size, size_t /* alignment */) {
+	void * Allocator::allocate(size_t size, size_t alignment) {
 #ifdef DEBUG_ALLOCATION
-		printf("allocate(%lu)\n", size);
+		printf("allocate(%lu, %lu)\n", size, alignment);
 #endif
-		BlockMeta *block = nullptr;
-
-		if (size <= 0)
+		// Nothing bigger than the whole heap could be satisfied, and turning such requests away here keeps the
+		// rounding below and the padding in allocateAligned from wrapping around.
+		if (size == 0 || getCapacity() < size || getCapacity() < alignment)
 			return nullptr;
 
-		if (!base) {
-			block = requestSpace(nullptr, size);
+		// Rounding every request up to the alignment keeps the heap tiled by whole size classes.
+		size = Util::upalign(size, MEMORY_ALIGN);
+
+		if (MEMORY_ALIGN < alignment)
+			return allocateAligned(size, alignment);
+
+		BlockMeta *block = findFreeBlock(size);
+		if (!block) {
+			block = requestSpace(size);
 			if (!block)
 				return nullptr;
-			base = block;
 		} else {
-			BlockMeta *last = base;
-			block = findFreeBlock(last, size);
-			if (!block) {
-				block = requestSpace(last, size);
-				if (!block)
-					return nullptr;
-			} else {
-				split(*block, size);
-				block->free = 0;
-			}
+			removeFree(*block);
+			block->free = false;
+			split(*block, size);
 		}
 
-		allocated += block->size + sizeof(BlockMeta);
+		++stats.allocations[statClassOf(size)];
+		countAllocated(block->size + sizeof(BlockMeta));
+		return block + 1;
+	}
+
+	void * Allocator::allocateAligned(size_t size, size_t alignment) {
+#ifdef DEBUG_ALLOCATION
+		printf("allocateAligned(%lu, %lu)\n", size, alignment);
+#endif
+		if (alignment & (alignment - 1))
+			return nullptr;
+
+		// Whatever block is found is split in up to three: a free front remainder that absorbs the misalignment, the
+		// aligned block itself and a free back remainder. The front remainder has to be big enough to be a block of
+		// its own, so in the worst case the aligned payload starts one whole alignment further in.
+		const size_t padded = size + alignment + sizeof(BlockMeta) + MEMORY_ALIGN;
+
+		BlockMeta *block = findFreeBlock(padded);
+		if (block) {
+			removeFree(*block);
+			block->free = false;
+		} else if (!(block = requestSpace(padded)))
+			return nullptr;
+
+		const uintptr_t payload = reinterpret_cast<uintptr_t>(block + 1);
+		uintptr_t aligned = Util::upalign(payload, alignment);
+		if (aligned != payload && aligned - payload < sizeof(BlockMeta) + MEMORY_ALIGN)
+			aligned += alignment;
+
+		if (aligned != payload) {
+			BlockMeta *front = block;
+			block = reinterpret_cast<BlockMeta *>(aligned) - 1;
+			block->size = front->size - (aligned - payload);
+			block->free = false;
+			front->size = reinterpret_cast<uintptr_t>(block) - payload;
+			block->prevSize = front->size;
+
+			if (tail == front)
+				tail = block;
+			else
+				nextBlock(*block)->prevSize = block->size;
+
+			front->free = true;
+			insertFree(*coalesce(*front));
+		}
+
+		split(*block, size);
+		++stats.allocations[statClassOf(size)];
+		countAllocated(block->size + sizeof(BlockMeta));
 		return block + 1;
 	}
 
@@ -103,35 +200,62 @@ namespace Armaz::Memory {
 #ifdef DEBUG_ALLOCATION
 		printf("split(0x%lx, %lu)\n", &block, size);
 #endif
-		if (block.size > size + sizeof(BlockMeta)) {
-			// We have enough space to split the block, unless alignment takes up too much.
-			BlockMeta *new_block = (BlockMeta *) realign((uintptr_t) &block + size + sizeof(BlockMeta) + 1);
-
-			// After we realign, we need to make sure that the new block's new size isn't negative.
-
-			if (block.next) {
-				const int new_size = (char *) block.next - (char *) new_block - sizeof(BlockMeta);
-
-				// Realigning the new block can make it too small, so we need to make sure the new block is big enough.
-				if (new_size > 0) {
-					new_block->size = new_size;
-					new_block->next = block.next;
-					new_block->free = 1;
-					block.next = new_block;
-					block.size = size;
-				}
-			} else {
-				const int new_size = (char *) &block + block.size - (char *) new_block;
-
-				if (new_size > 0) {
-					new_block->size = new_size;
-					new_block->free = 1;
-					new_block->next = nullptr;
-					block.size = size;
-					block.next = new_block;
-				}
-			}
+		// The remainder needs room for its own header and for the links it will carry while it's free.
+		if (block.size < size + sizeof(BlockMeta) + MEMORY_ALIGN)
+			return;
+
+		BlockMeta *new_block = reinterpret_cast<BlockMeta *>(reinterpret_cast<char *>(&block + 1) + size);
+		new_block->size = block.size - size - sizeof(BlockMeta);
+		new_block->prevSize = size;
+		new_block->free = true;
+		block.size = size;
+
+		if (tail == &block)
+			tail = new_block;
+		else
+			nextBlock(*new_block)->prevSize = new_block->size;
+
+		// When a live block shrinks, the remainder may border a free block.
+		insertFree(*coalesce(*new_block));
+	}
+
+	bool Allocator::tryExpand(void *ptr, size_t size) {
+#ifdef DEBUG_ALLOCATION
+		printf("tryExpand(0x%lx, %lu)\n", ptr, size);
+#endif
+		if (!ptr || size == 0 || getCapacity() < size)
+			return false;
+
+		size = Util::upalign(size, MEMORY_ALIGN);
+		BlockMeta *block = getBlock(ptr);
+		const size_t old_size = block->size;
+
+		if (block->size < size) {
+			BlockMeta *next = block == tail? nullptr : nextBlock(*block);
+
+			if (next && next->free && size <= block->size + sizeof(BlockMeta) + next->size) {
+				removeFree(*next);
+				block->size += sizeof(BlockMeta) + next->size;
+				if (tail == next)
+					tail = block;
+				else
+					nextBlock(*block)->prevSize = block->size;
+			} else if (!next || (next->free && next == tail)) {
+				// The block can be stretched toward the end of the heap, absorbing the free tail if there is one.
+				if (!grow(reinterpret_cast<char *>(ptr) + size))
+					return false;
+				if (next)
+					removeFree(*next);
+				block->size = size;
+				tail = block;
+			} else
+				return false;
 		}
+
+		split(*block, size);
+		allocated -= old_size;
+		countAllocated(block->size);
+		return true;
 	}
 
 	Allocator::BlockMeta * Allocator::getBlock(void *ptr) {
@@ -149,27 +273,143 @@ namespace Armaz::Memory {
 			return;
 
 		BlockMeta *block_ptr = getBlock(ptr);
-		block_ptr->free = 1;
+		block_ptr->free = true;
 		allocated -= block_ptr->size + sizeof(BlockMeta);
-		merge();
+		++stats.frees[statClassOf(block_ptr->size)];
+		insertFree(*coalesce(*block_ptr));
 	}
 
-	int Allocator::merge() {
+	Allocator::BlockMeta * Allocator::coalesce(BlockMeta &block) {
 #ifdef DEBUG_ALLOCATION
-		printf("merge()\n");
-#endif
-		int count = 0;
-		BlockMeta *current = base;
-		while (current && current->next) {
-			if (current->free && current->next->free) {
-				current->size += sizeof(BlockMeta) + current->next->size;
-				current->next = current->next->next;
-				count++;
-			} else
-				current = current->next;
+		printf("coalesce(0x%lx)\n", &block);
+#endif
+		// Only the two physical neighbours can be merged with, so this takes constant time regardless of heap size.
+		BlockMeta *merged = &block;
+
+		if (&block != tail) {
+			BlockMeta *next = nextBlock(block);
+			if (next->free) {
+				removeFree(*next);
+				block.size += sizeof(BlockMeta) + next->size;
+				if (tail == next)
+					tail = &block;
+			}
+		}
+
+		if (&block != base) {
+			BlockMeta *previous = previousBlock(block);
+			if (previous->free) {
+				removeFree(*previous);
+				previous->size += sizeof(BlockMeta) + block.size;
+				if (tail == &block)
+					tail = previous;
+				merged = previous;
+			}
+		}
+
+		if (merged != tail)
+			nextBlock(*merged)->prevSize = merged->size;
+
+		return merged;
+	}
+
+	void Allocator::insertFree(BlockMeta &block) {
+		freeBytes += block.size;
+		if (block.size <= SMALL_MAX) {
+			const size_t index = classOf(block.size);
+			FreeNode *node = reinterpret_cast<FreeNode *>(&block + 1);
+			node->prev = nullptr;
+			node->next = bins[index];
+			if (node->next)
+				node->next->prev = node;
+			bins[index] = node;
+			binMap |= 1u << index;
+		} else
+			tree = treeInsert(tree, reinterpret_cast<TreeNode *>(&block + 1));
+	}
+
+	void Allocator::removeFree(BlockMeta &block) {
+		freeBytes -= block.size;
+		if (block.size <= SMALL_MAX) {
+			const size_t index = classOf(block.size);
+			FreeNode *node = reinterpret_cast<FreeNode *>(&block + 1);
+			if (node->prev)
+				node->prev->next = node->next;
+			else
+				bins[index] = node->next;
+			if (node->next)
+				node->next->prev = node->prev;
+			if (!bins[index])
+				binMap &= ~(1u << index);
+		} else
+			tree = treeRemove(tree, reinterpret_cast<TreeNode *>(&block + 1));
+	}
+
+	Allocator::TreeNode * Allocator::treeInsert(TreeNode *root, TreeNode *node) {
+		if (!root) {
+			node->left = node->right = nullptr;
+			return node;
 		}
 
-		return count;
+		if (treeLess(node, root)) {
+			root->left = treeInsert(root->left, node);
+			if (treePriority(root) < treePriority(root->left)) {
+				TreeNode *left = root->left;
+				root->left = left->right;
+				left->right = root;
+				return left;
+			}
+		} else {
+			root->right = treeInsert(root->right, node);
+			if (treePriority(root) < treePriority(root->right)) {
+				TreeNode *right = root->right;
+				root->right = right->left;
+				right->left = root;
+				return right;
+			}
+		}
+
+		return root;
+	}
+
+	Allocator::TreeNode * Allocator::treeRemove(TreeNode *root, TreeNode *node) {
+		if (!root)
+			return nullptr;
+		if (root == node)
+			return treeJoin(root->left, root->right);
+		if (treeLess(node, root))
+			root->left = treeRemove(root->left, node);
+		else
+			root->right = treeRemove(root->right, node);
+		return root;
+	}
+
+	Allocator::TreeNode * Allocator::treeJoin(TreeNode *left, TreeNode *right) {
+		if (!left)
+			return right;
+		if (!right)
+			return left;
+		if (treePriority(right) < treePriority(left)) {
+			left->right = treeJoin(left->right, right);
+			return left;
+		}
+		right->left = treeJoin(left, right->left);
+		return right;
+	}
+
+	bool Allocator::treeLess(const TreeNode *left, const TreeNode *right) {
+		const size_t left_size  = blockOf(const_cast<TreeNode *>(left))->size;
+		const size_t right_size = blockOf(const_cast<TreeNode *>(right))->size;
+		return left_size < right_size || (left_size == right_size && left < right);
+	}
+
+	uint64_t Allocator::treePriority(const TreeNode *node) {
+		// A cheap integer hash of the node's address stands in for the random priority of a textbook treap.
+		uint64_t x = reinterpret_cast<uintptr_t>(node);
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdul;
+		x ^= x >> 33;
+		return x;
 	}
 
 	void Allocator::setBounds(char *new_start, char *new_high) {
@@ -179,25 +419,194 @@ namespace Armaz::Memory {
 		start = (char *) realign((uintptr_t) new_start);
 		highestAllocated = reinterpret_cast<uintptr_t>(start);
 		high = new_high;
-		end = new_start;
+		end = start;
+	}
+
+	bool Allocator::contains(const void *ptr) const {
+		return start <= ptr && ptr <= high;
 	}
 
 	size_t Allocator::getAllocated() const {
 		return allocated;
 	}
 
+	size_t Allocator::getCapacity() const {
+		return start < high? high - start : 0;
+	}
+
 	size_t Allocator::getUnallocated() const {
 		return high - start - allocated;
 	}
+
+	size_t Allocator::getLargestFree() const {
+		if (tree) {
+			const TreeNode *node = tree;
+			while (node->right)
+				node = node->right;
+			return blockOf(const_cast<TreeNode *>(node))->size;
+		}
+
+		if (binMap)
+			return (32 - __builtin_clz(binMap)) * MEMORY_ALIGN;
+
+		return 0;
+	}
+
+	double Allocator::getFragmentation() const {
+		if (freeBytes == 0)
+			return 0.;
+		return 1. - static_cast<double>(getLargestFree()) / freeBytes;
+	}
+
+	void Allocator::countAllocated(size_t bytes) {
+		allocated += bytes;
+		if (stats.peak < allocated)
+			stats.peak = allocated;
+	}
+
+#ifndef ARMAZ_HOST
+	void * CoreCache::allocate(size_t size) {
+		if (size == 0 || Allocator::SMALL_MAX < size)
+			return nullptr;
+
+		const size_t index = Allocator::classOf(Util::upalign(size, MEMORY_ALIGN));
+		enterCritical(Level::IRQ);
+
+		if (heads[index]) {
+			++stats.hits;
+		} else {
+			++stats.misses;
+			refill(index);
+			if (!heads[index]) {
+				leaveCritical();
+				return nullptr;
+			}
+		}
+
+		Entry *entry = heads[index];
+		heads[index] = entry->next;
+		--counts[index];
+		leaveCritical();
+		return entry;
+	}
+
+	bool CoreCache::free(void *ptr) {
+		const size_t size = global_memory->getBlock(ptr)->size;
+		if (Allocator::SMALL_MAX < size)
+			return false;
+
+		const size_t index = Allocator::classOf(size);
+		enterCritical(Level::IRQ);
+
+		Entry *entry = reinterpret_cast<Entry *>(ptr);
+		entry->next = heads[index];
+		heads[index] = entry;
+
+		if (LIMIT < ++counts[index]) {
+			++stats.drains;
+			release(index, BATCH);
+		}
+
+		leaveCritical();
+		return true;
+	}
+
+	void CoreCache::drain() {
+		enterCritical(Level::IRQ);
+		for (size_t index = 0; index < Allocator::SMALL_CLASSES; ++index)
+			release(index, counts[index]);
+		leaveCritical();
+	}
+
+	size_t CoreCache::getCachedBytes() const {
+		size_t out = 0;
+		for (size_t index = 0; index < Allocator::SMALL_CLASSES; ++index)
+			out += counts[index] * (index + 1) * MEMORY_ALIGN;
+		return out;
+	}
+
+	void CoreCache::refill(size_t index) {
+		const size_t size = (index + 1) * MEMORY_ALIGN;
+		heapLock.acquire();
+		for (size_t i = 0; i < BATCH; ++i) {
+			Entry *entry = reinterpret_cast<Entry *>(global_memory->allocate(size));
+			if (!entry)
+				break;
+			entry->next = heads[index];
+			heads[index] = entry;
+			++counts[index];
+		}
+		heapLock.release();
+		++stats.refills;
+	}
+
+	void CoreCache::release(size_t index, size_t count) {
+		heapLock.acquire();
+		for (; count && heads[index]; --count) {
+			Entry *entry = heads[index];
+			heads[index] = entry->next;
+			--counts[index];
+			global_memory->free(entry);
+		}
+		heapLock.release();
+	}
+
+	CoreCache & getCoreCache() {
+		return coreCaches[ARM::getCore()];
+	}
+
+	CoreCache & getCoreCache(unsigned core) {
+		return coreCaches[core];
+	}
+
+	/** Returns the byte heap a pointer belongs to, or nullptr if it's a page run (or not allocated at all). The heaps
+	 *  are page runs themselves, so this has to be checked before findPages. */
+	static Allocator * findHeap(const void *ptr) {
+		if (global_memory->contains(ptr))
+			return global_memory;
+		Allocator *dma_heap = getDMAHeap();
+		if (dma_heap && dma_heap->contains(ptr))
+			return dma_heap;
+		return nullptr;
+	}
+
+	void * allocateDMA(size_t size, size_t alignment) {
+		if (alignment < DMA_ALIGN)
+			alignment = DMA_ALIGN;
+		size = Util::upalign(size, DMA_ALIGN);
+
+		if (PAGE_ALLOCATION_MIN <= size && alignment <= PAGE_SIZE)
+			if (void *run = allocatePageBytes(size, Zone::DMA))
+				return run;
+
+		Allocator *dma_heap = getDMAHeap();
+		if (!dma_heap)
+			return nullptr;
+
+		heapLock.acquire();
+		void *result = dma_heap->allocate(size, alignment);
+		heapLock.release();
+		return result;
+	}
+#endif
 }
 
+#ifndef ARMAZ_HOST
 extern "C" void * malloc(size_t size) {
 #ifdef DEBUG_ALLOCATION
 	printf("malloc(0x%lx)\n", size);
 #endif
 	if (global_memory == nullptr)
 		return nullptr;
-	auto result = global_memory->allocate(size);
+	if (Armaz::Memory::PAGE_ALLOCATION_MIN <= size)
+		if (void *run = Armaz::Memory::allocatePageBytes(size))
+			return run;
+	void *result = Armaz::Memory::getCoreCache().allocate(size);
+	if (!result) {
+		Armaz::Memory::heapLock.acquire();
+		result = global_memory->allocate(size);
+		Armaz::Memory::heapLock.release();
+	}
 #ifdef DEBUG_ALLOCATION
 	printf("malloc complete: 0x%llx\n", result);
 #endif
@@ -205,16 +614,93 @@ extern "C" void * malloc(size_t size) {
 }
 
 extern "C" void * calloc(size_t count, size_t size) {
+#ifdef DEBUG_ALLOCATION
 	printf("calloc(0x%llx x 0x%llx)\n", count, size);
+#endif
 	void *chunk = malloc(count * size);
 	if (chunk)
 		memset(chunk, 0, count * size);
 	return chunk;
 }
 
+extern "C" void * realloc(void *ptr, size_t size) {
+	if (!ptr)
+		return malloc(size);
+
+	if (size == 0) {
+		free(ptr);
+		return nullptr;
+	}
+
+	if (try_expand(ptr, size))
+		return ptr;
+
+	Armaz::Memory::Allocator *heap = Armaz::Memory::findHeap(ptr);
+	const size_t old_size = heap? heap->getBlock(ptr)->size : Armaz::Memory::findPages(ptr)->getSize(ptr);
+	// DMA allocations stay in the DMA zone when they move.
+	void *new_ptr = heap && heap == Armaz::Memory::getDMAHeap()? Armaz::Memory::allocateDMA(size) : malloc(size);
+	if (!new_ptr)
+		return nullptr;
+
+	memcpy(new_ptr, ptr, old_size < size? old_size : size);
+	free(ptr);
+	return new_ptr;
+}
+
+extern "C" bool try_expand(void *ptr, size_t size) {
+	if (global_memory == nullptr)
+		return false;
+	Armaz::Memory::Allocator *heap = Armaz::Memory::findHeap(ptr);
+	if (!heap) {
+		Armaz::Memory::PageAllocator *pages = Armaz::Memory::findPages(ptr);
+		return pages && size <= pages->getSize(ptr);
+	}
+	Armaz::Memory::heapLock.acquire();
+	const bool result = heap->tryExpand(ptr, size);
+	Armaz::Memory::heapLock.release();
+	return result;
+}
+
+extern "C" void * aligned_alloc(size_t alignment, size_t size) {
+	if (alignment <= Armaz::Memory::MEMORY_ALIGN)
+		return malloc(size);
+	if (global_memory == nullptr)
+		return nullptr;
+	// Page runs are aligned to their own size, which is at least PAGE_SIZE.
+	if (Armaz::Memory::PAGE_ALLOCATION_MIN <= size && alignment <= PAGE_SIZE)
+		if (void *run = Armaz::Memory::allocatePageBytes(size))
+			return run;
+	Armaz::Memory::heapLock.acquire();
+	void *result = global_memory->allocate(size, alignment);
+	Armaz::Memory::heapLock.release();
+	return result;
+}
+
+extern "C" int posix_memalign(void **memptr, size_t alignment, size_t size) {
+	if (alignment == 0 || alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+		return EINVAL;
+	void *result = aligned_alloc(alignment, size);
+	if (!result && size)
+		return ENOMEM;
+	*memptr = result;
+	return 0;
+}
+
 extern "C" void free(void *ptr) {
-	if (global_memory)
-		global_memory->free(ptr);
+	if (!global_memory || !ptr)
+		return;
+	Armaz::Memory::Allocator *heap = Armaz::Memory::findHeap(ptr);
+	if (!heap) {
+		if (Armaz::Memory::PageAllocator *pages = Armaz::Memory::findPages(ptr))
+			pages->free(ptr);
+		return;
+	}
+	// Only blocks from the global heap may pass through the caches, which refill from and drain to it.
+	if (heap != global_memory || !Armaz::Memory::getCoreCache().free(ptr)) {
+		Armaz::Memory::heapLock.acquire();
+		heap->free(ptr);
+		Armaz::Memory::heapLock.release();
+	}
 }
 
 #ifdef __clang__
@@ -226,6 +712,12 @@ void * operator new[](size_t size) {
 	auto result = malloc(size);
 	return result;
 }
+void * operator new(size_t size, std::align_val_t alignment)   {
+	return aligned_alloc(static_cast<size_t>(alignment), size);
+}
+void * operator new[](size_t size, std::align_val_t alignment) {
+	return aligned_alloc(static_cast<size_t>(alignment), size);
+}
 void * operator new(size_t, void *ptr)   {
 	return ptr;
 }
@@ -238,8 +730,15 @@ void operator delete(void *ptr)   noexcept {
 void operator delete[](void *ptr) noexcept {
 	free(ptr);
 }
+void operator delete(void *ptr, std::align_val_t)   noexcept {
+	free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+	free(ptr);
+}
 void operator delete(void *, void *)   noexcept {}
 void operator delete[](void *, void *) noexcept {}
 void operator delete(void *, unsigned long)   noexcept {}
 void operator delete[](void *, unsigned long) noexcept {}
 #endif
+#endif // ARMAZ_HOST
@@ -0,0 +1,128 @@
+#include <string.h>
+
+#include "assert.h"
+#include "PageAllocator.h"
+
+namespace Armaz::Memory {
+	void PageAllocator::init(uintptr_t start_, uintptr_t end_) {
+		constexpr uintptr_t max_run = static_cast<uintptr_t>(PAGE_SIZE) << MAX_ORDER;
+
+		start = (start_ + PAGE_SIZE - 1) & ~static_cast<uintptr_t>(PAGE_SIZE - 1);
+		end   = end_ & ~static_cast<uintptr_t>(PAGE_SIZE - 1);
+		base  = start & ~(max_run - 1);
+		assert(start < end);
+
+		pageCount = indexOf(end);
+		states = reinterpret_cast<uint8_t *>(start);
+		memset(states, 0, pageCount);
+		start += (pageCount + PAGE_SIZE - 1) & ~static_cast<size_t>(PAGE_SIZE - 1);
+
+		// Hand the remaining pages over as the largest naturally aligned runs that fit.
+		for (size_t index = indexOf(start); index < pageCount;) {
+			size_t order = MAX_ORDER;
+			while (order && ((index & ((1ul << order) - 1)) || pageCount < index + (1ul << order)))
+				--order;
+			push(index, order);
+			freePages += 1ul << order;
+			index += 1ul << order;
+		}
+	}
+
+	void * PageAllocator::allocate(size_t order) {
+		if (MAX_ORDER < order)
+			return nullptr;
+
+		lock.acquire();
+
+		size_t current = order;
+		while (current <= MAX_ORDER && !lists[current])
+			++current;
+
+		if (MAX_ORDER < current) {
+			lock.release();
+			return nullptr;
+		}
+
+		const size_t index = indexOf(reinterpret_cast<uintptr_t>(lists[current]));
+		remove(index, current);
+
+		// Give back the upper halves until the run is the requested size.
+		while (order < current) {
+			--current;
+			push(index + (1ul << current), current);
+		}
+
+		states[index] = USED | order;
+		freePages -= 1ul << order;
+		lock.release();
+		return reinterpret_cast<void *>(addressOf(index));
+	}
+
+	void * PageAllocator::allocateBytes(size_t bytes) {
+		return allocate(orderFor(bytes));
+	}
+
+	void PageAllocator::free(void *ptr) {
+		if (!ptr)
+			return;
+
+		assert(contains(ptr));
+		size_t index = indexOf(reinterpret_cast<uintptr_t>(ptr));
+
+		lock.acquire();
+		assert(states[index] & USED);
+		size_t order = states[index] & ORDER_MASK;
+		states[index] = 0;
+		freePages += 1ul << order;
+
+		while (order < MAX_ORDER) {
+			const size_t buddy = index ^ (1ul << order);
+			if (pageCount <= buddy || states[buddy] != (FREE | order))
+				break;
+			remove(buddy, order);
+			index &= ~(1ul << order);
+			++order;
+		}
+
+		push(index, order);
+		lock.release();
+	}
+
+	bool PageAllocator::contains(const void *ptr) const {
+		const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+		return start <= address && address < end;
+	}
+
+	size_t PageAllocator::getSize(const void *ptr) const {
+		return static_cast<size_t>(PAGE_SIZE) << (states[indexOf(reinterpret_cast<uintptr_t>(ptr))] & ORDER_MASK);
+	}
+
+	size_t PageAllocator::orderFor(size_t bytes) {
+		// Stopping past MAX_ORDER also keeps the shift from wrapping to zero for sizes above 2^63.
+		size_t order = 0;
+		while (order <= MAX_ORDER && (static_cast<size_t>(PAGE_SIZE) << order) < bytes)
+			++order;
+		return order;
+	}
+
+	void PageAllocator::push(size_t index, size_t order) {
+		FreeNode *node = reinterpret_cast<FreeNode *>(addressOf(index));
+		node->prev = nullptr;
+		node->next = lists[order];
+		if (node->next)
+			node->next->prev = node;
+		lists[order] = node;
+		states[index] = FREE | order;
+	}
+
+	void PageAllocator::remove(size_t index, size_t order) {
+		FreeNode *node = reinterpret_cast<FreeNode *>(addressOf(index));
+		if (node->prev)
+			node->prev->next = node->next;
+		else
+			lists[order] = node->next;
+		if (node->next)
+			node->next->prev = node->prev;
+		states[index] = 0;
+	}
+}
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+
+#include "Kernel.h"
+#include "Memory.h"
+#include "Pager.h"
+#include "Zone.h"
+#include "util.h"
+
+namespace Armaz {
+	static Pager kernelPager;
+
+	Pager & Kernel::getPager() {
+		return kernelPager;
+	}
+
+	void * Pager::reserve(size_t bytes) {
+		if (bytes == 0)
+			return nullptr;
+
+		bytes = Util::upalign(bytes, PAGE_SIZE);
+		lock.acquire();
+
+		void *result = nullptr;
+		if (bytes < WINDOW_END - next)
+			for (Reservation &reservation: reservations)
+				if (reservation.start == 0) {
+					reservation.start = next;
+					reservation.end = next + bytes;
+					// The page after the end stays unreserved so that overruns fault.
+					next += bytes + PAGE_SIZE;
+					reservedBytes += bytes;
+					result = reinterpret_cast<void *>(reservation.start);
+					break;
+				}
+
+		lock.release();
+		return result;
+	}
+
+	bool Pager::release(void *pointer) {
+		const uintptr_t start = reinterpret_cast<uintptr_t>(pointer);
+		lock.acquire();
+
+		for (Reservation &reservation: reservations)
+			if (reservation.start != 0 && reservation.start == start) {
+				for (uintptr_t page = reservation.start; page < reservation.end; page += PAGE_SIZE)
+					if (const uintptr_t physical = MMU::unmapPage(page)) {
+						free(reinterpret_cast<void *>(physical));
+						--committedPages;
+					}
+				reservedBytes -= reservation.end - reservation.start;
+				reservation = {};
+				lock.release();
+				return true;
+			}
+
+		lock.release();
+		return false;
+	}
+
+	bool Pager::assignAddress(void *address) {
+		const uintptr_t page = Util::downalign(reinterpret_cast<uintptr_t>(address), PAGE_SIZE);
+		if (MMU::isMapped(page))
+			return true;
+
+		lock.acquire();
+		const bool success = findReservation(page) && commit(page);
+		lock.release();
+		return success;
+	}
+
+	bool Pager::handleFault(uintptr_t address) {
+		const uintptr_t page = Util::downalign(address, PAGE_SIZE);
+		lock.acquire();
+		// Another core may have mapped the page between the fault and now.
+		const bool success = findReservation(page) && (MMU::isMapped(page) || commit(page));
+		if (success)
+			++faults;
+		lock.release();
+		return success;
+	}
+
+	const Pager::Reservation * Pager::findReservation(uintptr_t address) const {
+		if (address < WINDOW_START || next <= address)
+			return nullptr;
+		for (const Reservation &reservation: reservations)
+			if (reservation.start <= address && address < reservation.end)
+				return &reservation;
+		return nullptr;
+	}
+
+	bool Pager::commit(uintptr_t page) {
+		void *physical = Memory::allocatePages(0);
+		if (!physical)
+			return false;
+
+		Memory::zeroPages(physical, 1);
+		if (!MMU::mapPage(page, reinterpret_cast<uintptr_t>(physical))) {
+			free(physical);
+			return false;
+		}
+
+		++committedPages;
+		return true;
+	}
+}
@@ -0,0 +1,299 @@
+#include <stdlib.h>
+
+#include "assert.h"
+#include "Scheduler.h"
+#include "Zone.h"
+#include "aarch64/ARM.h"
+#include "aarch64/Synchronize.h"
+#include "aarch64/Timer.h"
+#include "interrupts/IPI.h"
+#include "interrupts/IRQ.h"
+
+/** Whose values each core's vector registers hold and whose they should hold. Kept in context.S. */
+extern "C" Armaz::FPState *fpOwners[CORES];
+extern "C" Armaz::FPState *fpCurrents[CORES];
+
+namespace Armaz {
+	static_assert(__builtin_offsetof(Context, sp) == 96 && __builtin_offsetof(Context, fp) == 104,
+		"context.S expects this layout");
+	static_assert(__builtin_offsetof(FPState, fpcr) == 512 && __builtin_offsetof(FPState, fpsr) == 520,
+		"context.S expects this layout");
+	static_assert(Scheduler::STACK_SIZE == PAGE_SIZE, "Stacks are allocated as single pages");
+
+	namespace {
+		Scheduler schedulers[CORES];
+
+		constexpr uint64_t SPSR_MODE_MASK = 0xf;
+		/** EL1 on SP_EL0, where threads run. Exception handlers run on SP_EL1 and are never preempted. */
+		constexpr uint64_t SPSR_MODE_EL1T = 0b0100;
+
+		uint64_t maskIRQs() {
+			uint64_t daif;
+			asm volatile("mrs %0, daif; msr daifset, #2" : "=r"(daif) :: "memory");
+			return daif;
+		}
+
+		void restoreIRQs(uint64_t daif) {
+			asm volatile("msr daif, %0" :: "r"(daif) : "memory");
+		}
+
+		/** Whether the calling code is an exception handler, which can't switch threads. */
+		bool onExceptionStack() {
+			uint64_t spsel;
+			asm volatile("mrs %0, spsel" : "=r"(spsel));
+			return spsel & 1;
+		}
+
+		void reschedule() {
+			Scheduler::get()->requestReschedule();
+		}
+
+		void wake(void *) {
+			Scheduler::get()->tick();
+		}
+	}
+
+	Thread::Thread(const char *name_): name(name_), state(State::Running) {
+		context.fp = &fpState;
+	}
+
+	Thread::Thread(const char *name_, Function function_, void *argument_, void *stack_, size_t stack_size):
+	name(name_), function(function_), argument(argument_), stack(stack_) {
+		// The first switch to the thread "returns" into runCurrent on the empty stack.
+		context.x30 = reinterpret_cast<uintptr_t>(&Scheduler::runCurrent);
+		context.sp = reinterpret_cast<uintptr_t>(stack_) + stack_size;
+		context.fp = &fpState;
+	}
+
+	Scheduler * Scheduler::get() {
+		return &schedulers[ARM::getCore()];
+	}
+
+	Scheduler * Scheduler::get(unsigned core) {
+		return core < CORES? &schedulers[core] : nullptr;
+	}
+
+	unsigned Scheduler::getCore() const {
+		return this - schedulers;
+	}
+
+	bool Scheduler::init() {
+		assert(this == get());
+		if (running)
+			return true;
+
+		Thread *thread = new Thread(getCore() == 0? "main" : "idle");
+		if (!thread)
+			return false;
+
+		const uint64_t daif = maskIRQs();
+		current = thread;
+		threadCount = 1;
+		// Whatever is in the vector registers belongs to the code that's been running so far.
+		fpOwners[getCore()] = fpCurrents[getCore()] = &thread->fpState;
+		IPI::setRescheduleHandler(reschedule);
+		running = true;
+		restoreIRQs(daif);
+		return true;
+	}
+
+	bool Scheduler::spawn(const char *name, Thread::Function function, void *argument) {
+		void *stack = Memory::allocatePages(0);
+		if (!stack)
+			return false;
+
+		Thread *thread = new Thread(name, function, argument, stack, STACK_SIZE);
+		if (!thread) {
+			free(stack);
+			return false;
+		}
+
+		const uint64_t daif = maskIRQs();
+		lock.acquire();
+		pushReady(thread);
+		++threadCount;
+		lock.release();
+		restoreIRQs(daif);
+
+		if (getCore() != ARM::getCore())
+			IPI::send(getCore(), IPI::Message::Reschedule);
+		return true;
+	}
+
+	bool Scheduler::yield() {
+		if (!running || onExceptionStack())
+			return false;
+		assert(this == get());
+
+		const uint64_t daif = maskIRQs();
+		lock.acquire();
+		wakeSleepers(Timers::getMicroseconds());
+		const bool others = readyHead != nullptr;
+		lock.release();
+
+		if (others)
+			schedule();
+		restoreIRQs(daif);
+		return others;
+	}
+
+	void Scheduler::sleep(uint64_t microseconds) {
+		if (!running || onExceptionStack()) {
+			Timers::waitMicroseconds(microseconds);
+			return;
+		}
+		assert(this == get());
+
+		const uint64_t daif = maskIRQs();
+		lock.acquire();
+		current->wakeTime = Timers::getMicroseconds() + microseconds;
+		current->state = Thread::State::Sleeping;
+		Thread **link = &sleeping;
+		while (*link && (*link)->wakeTime <= current->wakeTime)
+			link = &(*link)->next;
+		current->next = *link;
+		*link = current;
+		lock.release();
+
+		Timers::getTimer().add(current->wakeEvent, current->wakeTime, wake, nullptr);
+		schedule();
+		restoreIRQs(daif);
+	}
+
+	void Scheduler::exit() {
+		assert(running && this == get());
+		maskIRQs();
+		lock.acquire();
+		current->state = Thread::State::Finished;
+		--threadCount;
+		lock.release();
+		schedule();
+		// Finished threads are never picked again.
+		__builtin_unreachable();
+	}
+
+	void Scheduler::tick() {
+		if (!running)
+			return;
+		lock.acquire();
+		wakeSleepers(Timers::getMicroseconds());
+		if (readyHead)
+			needReschedule = true;
+		lock.release();
+	}
+
+	bool Scheduler::shouldPreempt(uint64_t spsr) {
+		const Scheduler *scheduler = get();
+		return scheduler->running && scheduler->needReschedule && !scheduler->inSchedule
+			&& (spsr & SPSR_MODE_MASK) == SPSR_MODE_EL1T;
+	}
+
+	void Scheduler::preempt() {
+		get()->schedule();
+	}
+
+	void Scheduler::runCurrent() {
+		Scheduler *scheduler = get();
+		// This is where the switch would have returned to if the thread had run before.
+		scheduler->inSchedule = false;
+		scheduler->reap();
+		Thread *thread = scheduler->current;
+		Interrupts::enableBoth();
+		thread->function(thread->argument);
+		scheduler->exit();
+	}
+
+	void Scheduler::pushReady(Thread *thread) {
+		thread->state = Thread::State::Ready;
+		thread->next = nullptr;
+		if (readyTail)
+			readyTail->next = thread;
+		else
+			readyHead = thread;
+		readyTail = thread;
+	}
+
+	Thread * Scheduler::popReady() {
+		Thread *thread = readyHead;
+		if (thread) {
+			readyHead = thread->next;
+			if (!readyHead)
+				readyTail = nullptr;
+			thread->next = nullptr;
+		}
+		return thread;
+	}
+
+	void Scheduler::wakeSleepers(uint64_t now) {
+		while (sleeping && sleeping->wakeTime <= now) {
+			Thread *thread = sleeping;
+			sleeping = thread->next;
+			// Whatever noticed first, the event mustn't outlive the sleep.
+			Timers::getTimer().cancel(thread->wakeEvent);
+			pushReady(thread);
+		}
+	}
+
+	void Scheduler::schedule() {
+		inSchedule = true;
+		Thread *previous = current;
+
+		lock.acquire();
+		Thread *next = popReady();
+		while (!next) {
+			if (previous->state == Thread::State::Running) {
+				next = previous;
+				break;
+			}
+
+			// Nothing can run. The pending interrupt that ends the wfi is taken before looking again, which is how
+			// a sleeper's wake event gets to run.
+			lock.release();
+			asm volatile("wfi");
+			Interrupts::enableIRQs();
+			instructionSyncBarrier();
+			Interrupts::disableIRQs();
+			lock.acquire();
+			wakeSleepers(Timers::getMicroseconds());
+			next = popReady();
+		}
+
+		if (next != previous) {
+			if (previous->state == Thread::State::Running)
+				pushReady(previous);
+			else if (previous->state == Thread::State::Finished) {
+				previous->next = zombies;
+				zombies = previous;
+			}
+			++switches;
+		}
+
+		next->state = Thread::State::Running;
+		current = next;
+		needReschedule = false;
+		lock.release();
+
+		if (next != previous)
+			switchContext(&previous->context, &next->context);
+
+		inSchedule = false;
+		reap();
+	}
+
+	void Scheduler::reap() {
+		lock.acquire();
+		Thread *thread = zombies;
+		zombies = nullptr;
+		lock.release();
+
+		while (thread) {
+			Thread *next = thread->next;
+			// Its registers are garbage now, so the next trap mustn't save them into freed memory.
+			if (fpOwners[getCore()] == &thread->fpState)
+				fpOwners[getCore()] = nullptr;
+			free(thread->stack);
+			delete thread;
+			thread = next;
+		}
+	}
+}
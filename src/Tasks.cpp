@@ -0,0 +1,154 @@
+#include "Scheduler.h"
+#include "Tasks.h"
+#include "aarch64/ARM.h"
+#include "aarch64/Synchronize.h"
+
+namespace Armaz::Tasks {
+	namespace {
+		/** A Chase-Lev deque with a fixed capacity. The owning core pushes and pops at the bottom and other cores
+		 *  steal from the top. Several threads can share a core, so the owner's operations run with IRQs masked to
+		 *  keep a preempted push or pop from being interleaved with another one. */
+		class alignas(L1_DATA_CACHE_LINE_LENGTH) Deque {
+			public:
+				bool push(Task *task) {
+					const int64_t bottom_ = __atomic_load_n(&bottom, __ATOMIC_RELAXED);
+					const int64_t top_ = __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+					if (static_cast<int64_t>(DEQUE_CAPACITY) <= bottom_ - top_)
+						return false;
+					__atomic_store_n(&tasks[bottom_ % DEQUE_CAPACITY], task, __ATOMIC_RELAXED);
+					__atomic_thread_fence(__ATOMIC_RELEASE);
+					__atomic_store_n(&bottom, bottom_ + 1, __ATOMIC_RELAXED);
+					return true;
+				}
+
+				Task * pop() {
+					const int64_t bottom_ = __atomic_load_n(&bottom, __ATOMIC_RELAXED) - 1;
+					__atomic_store_n(&bottom, bottom_, __ATOMIC_RELAXED);
+					__atomic_thread_fence(__ATOMIC_SEQ_CST);
+					int64_t top_ = __atomic_load_n(&top, __ATOMIC_RELAXED);
+
+					if (bottom_ < top_) {
+						__atomic_store_n(&bottom, bottom_ + 1, __ATOMIC_RELAXED);
+						return nullptr;
+					}
+
+					Task *task = __atomic_load_n(&tasks[bottom_ % DEQUE_CAPACITY], __ATOMIC_RELAXED);
+					if (top_ == bottom_) {
+						// The last task might be being stolen at the same time.
+						if (!__atomic_compare_exchange_n(&top, &top_, top_ + 1, false, __ATOMIC_SEQ_CST,
+						                                 __ATOMIC_RELAXED))
+							task = nullptr;
+						__atomic_store_n(&bottom, bottom_ + 1, __ATOMIC_RELAXED);
+					}
+					return task;
+				}
+
+				Task * steal() {
+					int64_t top_ = __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+					__atomic_thread_fence(__ATOMIC_SEQ_CST);
+					const int64_t bottom_ = __atomic_load_n(&bottom, __ATOMIC_ACQUIRE);
+					if (bottom_ <= top_)
+						return nullptr;
+
+					Task *task = __atomic_load_n(&tasks[top_ % DEQUE_CAPACITY], __ATOMIC_RELAXED);
+					if (!__atomic_compare_exchange_n(&top, &top_, top_ + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+						return nullptr;
+					return task;
+				}
+
+			private:
+				int64_t top = 0;
+				int64_t bottom = 0;
+				Task *tasks[DEQUE_CAPACITY] {};
+		};
+
+		Deque deques[CORES];
+
+		struct Chunk {
+			RangeFunction function;
+			void *argument;
+			size_t begin, end;
+		};
+
+		void runChunk(void *argument) {
+			const Chunk &chunk = *static_cast<Chunk *>(argument);
+			chunk.function(chunk.begin, chunk.end, chunk.argument);
+		}
+	}
+
+	void Task::run() {
+		function(argument);
+		__atomic_store_n(&done, true, __ATOMIC_RELEASE);
+		// Wakes any core waiting for it in wfe.
+		dataSyncBarrier();
+		asm volatile("sev");
+	}
+
+	void Task::join() {
+		while (!isDone())
+			if (!runOne() && !Scheduler::get()->yield())
+				asm volatile("wfe");
+	}
+
+	void spawn(Task &task) {
+		task.done = false;
+		enterCritical(Level::IRQ);
+		const bool pushed = deques[ARM::getCore()].push(&task);
+		leaveCritical();
+
+		if (!pushed) {
+			task.run();
+			return;
+		}
+
+		// Idle secondary cores wait in wfe until there's something to steal.
+		dataSyncBarrier();
+		asm volatile("sev");
+	}
+
+	bool runOne() {
+		const unsigned core = ARM::getCore();
+		enterCritical(Level::IRQ);
+		Task *task = deques[core].pop();
+		leaveCritical();
+
+		for (unsigned offset = 1; !task && offset < CORES; ++offset)
+			task = deques[(core + offset) % CORES].steal();
+
+		if (!task)
+			return false;
+		task->run();
+		return true;
+	}
+
+	void parallelFor(size_t begin, size_t end, RangeFunction function, void *argument, size_t grain) {
+		if (end <= begin)
+			return;
+
+		const size_t length = end - begin;
+		if (grain == 0)
+			grain = 1;
+		size_t chunks = (length + grain - 1) / grain;
+		if (MAX_CHUNKS < chunks)
+			chunks = MAX_CHUNKS;
+		const size_t chunk_length = (length + chunks - 1) / chunks;
+		chunks = (length + chunk_length - 1) / chunk_length;
+
+		Chunk pieces[MAX_CHUNKS];
+		Task tasks[MAX_CHUNKS];
+		for (size_t i = 0; i < chunks; ++i) {
+			const size_t piece_begin = begin + i * chunk_length;
+			const size_t piece_end = chunk_length < end - piece_begin? piece_begin + chunk_length : end;
+			pieces[i] = {function, argument, piece_begin, piece_end};
+			tasks[i] = Task(runChunk, &pieces[i]);
+		}
+
+		for (size_t i = 1; i < chunks; ++i)
+			spawn(tasks[i]);
+		runChunk(&pieces[0]);
+
+		// The newest tasks are at the bottom of this core's deque, so joining from the end pops them in order.
+		for (size_t i = chunks; 1 < i; --i)
+			tasks[i - 1].join();
+	}
+}
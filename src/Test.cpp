@@ -1,13 +1,32 @@
+#include <algorithm>
 #include <functional>
 #include <memory>
 
+#include "Arena.h"
+#include "Checksum.h"
 #include "Log.h"
+#include "Kernel.h"
+#include "Memory.h"
+#include "Pager.h"
+#include "Scheduler.h"
+#include "Tasks.h"
 #include "Test.h"
+#include "Zone.h"
 #include "util.h"
+#include "aarch64/ARM.h"
+#include "aarch64/Cores.h"
+#include "aarch64/MMU.h"
+#include "aarch64/PMU.h"
+#include "aarch64/Spinlock.h"
+#include "aarch64/Timer.h"
+#include "bench/AllocatorBench.h"
+#include "bench/MemoryBench.h"
 #include "fs/tfat/ThornFAT.h"
+#include "interrupts/IPI.h"
 #include "lib/printf.h"
 #include "pi/UART.h"
 #include "storage/EMMC.h"
+#include "storage/GPT.h"
 #include "storage/MBR.h"
 #include "storage/Partition.h"
 
@@ -18,6 +37,8 @@ namespace Armaz {
 	static std::string cwd = "/";
 	static uid_t uid = 0;
 	static gid_t gid = 0;
+	/** Scratch memory for a single command. Everything allocated from it is dropped when the command returns. */
+	static Memory::Arena scratch;
 	std::unique_ptr<Partition> partition;
 	std::unique_ptr<ThornFAT::ThornFATDriver> driver;
 
@@ -46,6 +67,7 @@ namespace Armaz {
 			return true;
 
 		const std::string &front = pieces.front();
+		Memory::Arena::Scope scratch_scope(scratch);
 
 #define Success(args...) do { Log::success(args); return true; } while (0)
 #define Error(args...) do { Log::error(args); return false; } while (0)
@@ -63,6 +85,78 @@ namespace Armaz {
 				mbr.debug();
 			else
 				return false;
+		} else if (front == "gpt") {
+			if (!readMBR())
+				return false;
+			if (!mbr.indicatesGPT())
+				Error("The MBR isn't a protective MBR.");
+
+			constexpr size_t SECTOR_SIZE = 512;
+			auto *header = static_cast<GPT::Header *>(scratch.allocate(SECTOR_SIZE, alignof(GPT::Header)));
+			if (!header)
+				Error("Couldn't allocate the header buffer.");
+			ssize_t status;
+			if ((status = emmc.read(header, SECTOR_SIZE, SECTOR_SIZE)) < 0)
+				Error("Failed to read the GPT header (%ld).", status);
+			if (!header->validate())
+				Error("The GPT header is invalid.");
+
+			const size_t entries_size = static_cast<size_t>(header->partitionCount) * header->partitionEntrySize;
+			if (header->partitionEntrySize < sizeof(GPT::PartitionEntry) || MEGABYTE < entries_size)
+				Error("Unreasonable partition array: %u entries of %u bytes", header->partitionCount,
+					header->partitionEntrySize);
+			char *entries = static_cast<char *>(scratch.allocate(entries_size, alignof(GPT::PartitionEntry)));
+			if (!entries)
+				Error("Couldn't allocate %lu bytes for the partition array.", entries_size);
+			if ((status = emmc.read(entries, entries_size, header->startLBA * SECTOR_SIZE)) < 0)
+				Error("Failed to read the partition array (%ld).", status);
+			if (!header->validatePartitions(entries))
+				Error("The partition array's CRC doesn't match.");
+
+			printf("Disk ");
+			header->guid.print();
+			for (uint32_t i = 0; i < header->partitionCount; ++i) {
+				auto &entry = *reinterpret_cast<GPT::PartitionEntry *>(entries + i * header->partitionEntrySize);
+				if (!entry.typeGUID)
+					continue;
+				printf("%3u: LBA %lu-%lu \"", i, entry.firstLBA, entry.lastLBA);
+				entry.printName(false);
+				printf("\" type ");
+				entry.typeGUID.print();
+			}
+		} else if (front == "crc") {
+			// The standard check values, then every length around the three-lane cutoff against a bitwise reference.
+			static const char digits[] = "123456789";
+			if (Checksum::crc32(digits, 9) != 0xcbf43926 || Checksum::crc32c(digits, 9) != 0xe3069283)
+				Error("Wrong check value: CRC-32 0x%08x, CRC-32C 0x%08x", Checksum::crc32(digits, 9),
+					Checksum::crc32c(digits, 9));
+
+			constexpr size_t LANES = 3 * 1024;
+			auto *buffer = static_cast<uint8_t *>(scratch.allocate(2 * LANES + 64, 1));
+			if (!buffer)
+				Error("Couldn't allocate buffer.");
+			for (size_t i = 0; i < 2 * LANES + 64; ++i)
+				buffer[i] = static_cast<uint8_t>(i * 131 + i / 7);
+
+			auto reference = [](const uint8_t *bytes, size_t size, uint32_t polynomial) {
+				uint32_t crc = ~0u;
+				for (size_t i = 0; i < size; ++i) {
+					crc ^= bytes[i];
+					for (int bit = 0; bit < 8; ++bit)
+						crc = crc & 1? (crc >> 1) ^ polynomial : crc >> 1;
+				}
+				return ~crc;
+			};
+
+			for (const size_t base: {LANES, 2 * LANES})
+				for (size_t size = base - 9; size <= base + 9; ++size)
+					for (size_t offset = 0; offset < 8; ++offset) {
+						const uint8_t *data = buffer + offset;
+						if (Checksum::crc32(data, size) != reference(data, size, Checksum::CRC32_POLYNOMIAL)
+						    || Checksum::crc32c(data, size) != reference(data, size, Checksum::CRC32C_POLYNOMIAL))
+							Error("Mismatch at %lu bytes from offset %lu.", size, offset);
+					}
+			Success("CRC-32 and CRC-32C match the check values and the bitwise reference.");
 		} else if (front == "tfat") {
 			auto usage = [] { Error("Usage:\n- tfat init\n- tfat make"); };
 			if (pieces.size() < 2 || pieces[1] == "?")
@@ -103,11 +197,25 @@ namespace Armaz {
 		} else if (front == "ls") {
 			CheckDriver();
 			const std::string path = 2 <= pieces.size()? FS::simplifyPath(cwd, pieces[1]) : cwd;
-			const int status = driver->readdir(path.c_str(), [](const char *str, off_t offset) {
-				printf("- %s @ %lld\n", str, offset);
+			struct Entry {
+				const char *name;
+				off_t offset;
+			};
+			std::vector<Entry, Memory::ArenaAllocator<Entry>> entries {Memory::ArenaAllocator<Entry>(scratch)};
+			const int status = driver->readdir(path.c_str(), [&entries](const char *str, off_t offset) {
+				const size_t length = strlen(str) + 1;
+				if (char *name = static_cast<char *>(scratch.allocate(length, 1))) {
+					memcpy(name, str, length);
+					entries.push_back({name, offset});
+				}
 			});
 			if (status != 0)
 				Error("readdir status: %d", status);
+			std::sort(entries.begin(), entries.end(), [](const Entry &left, const Entry &right) {
+				return strcmp(left.name, right.name) < 0;
+			});
+			for (const Entry &entry: entries)
+				printf("- %s @ %lld\n", entry.name, entry.offset);
 		} else if (front == "readblock") {
 			if (pieces.size() != 2)
 				Error("Usage: readblock <byte offset>");
@@ -168,19 +276,16 @@ namespace Armaz {
 				return true;
 			}
 			Log::info("Size: %lu", size);
-			char *buffer = new char[size];
+			char *buffer = static_cast<char *>(scratch.allocate(size, 1));
 			if (!buffer)
 				Error("Couldn't allocate buffer.");
 			status = driver->read(path.c_str(), buffer, size, 0);
-			if (status < 0) {
-				delete[] buffer;
+			if (status < 0)
 				Error("read status: %d", status);
-			}
 			Log::success("Read \e[1m%lu\e[22m bytes from \e[1m%s\e[22m:", size, path.c_str());
 			for (size_t i = 0; i < size; ++i)
 				UART::write(buffer[i]);
 			UART::write('\n');
-			delete[] buffer;
 		} else if (front == "write") {
 			if (pieces.size() < 2)
 				Error("Usage: write <path> [data]...");
@@ -268,6 +373,336 @@ namespace Armaz {
 		} else if (front == "pwd") {
 			CheckDriver();
 			Log::info("Current working directory: \e[1m%s\e[22m", cwd.c_str());
+		} else if (front == "cores") {
+			Log::info("%u of %u cores online", Cores::getOnlineCount(), CORES);
+			for (unsigned core = 0; core < CORES; ++core) {
+				if (!Cores::isOnline(core))
+					continue;
+				// Each core reports the core it ran on over a remote call.
+				unsigned reported = CORES;
+				const uint64_t start = Timers::getSystemTimer();
+				IPI::call(core, [](void *argument) { *static_cast<unsigned *>(argument) = ARM::getCore(); }, &reported);
+				Log::info("Core %u answered as core %u in %lu us (%s)", core, reported,
+					Timers::getSystemTimer() - start, Cores::isIdle(core)? "idle" : "busy");
+			}
+		} else if (front == "threads") {
+			unsigned long count = 0;
+			if (2 < pieces.size() || (pieces.size() == 2 && !Util::parseUlong(pieces[1], count)))
+				Error("Usage: threads [spawn count]");
+
+			if (count) {
+				struct Shared {
+					unsigned finished = 0;
+					unsigned wrong = 0;
+				} shared;
+
+				unsigned spawned = 0;
+				const uint64_t start = Timers::getSystemTimer();
+				for (unsigned long i = 0; i < count; ++i) {
+					Scheduler *scheduler = Scheduler::get(i % CORES);
+					if (!scheduler->isRunning())
+						continue;
+					spawned += scheduler->spawn("test", [](void *argument) {
+						Shared &shared = *static_cast<Shared *>(argument);
+						// The sum stays in a vector register while other threads get the core.
+						double sum = 0.;
+						for (int step = 1; step <= 10; ++step) {
+							sum += step * 0.5;
+							Scheduler::get()->sleep(20'000);
+						}
+						if (sum != 27.5)
+							__atomic_add_fetch(&shared.wrong, 1, __ATOMIC_RELAXED);
+						__atomic_add_fetch(&shared.finished, 1, __ATOMIC_RELEASE);
+					}, &shared);
+				}
+
+				while (__atomic_load_n(&shared.finished, __ATOMIC_ACQUIRE) < spawned)
+					Scheduler::get()->sleep(10'000);
+				Log::info("%u threads finished in %lu us; %u got the wrong sum", spawned,
+					Timers::getSystemTimer() - start, shared.wrong);
+			}
+
+			for (unsigned core = 0; core < CORES; ++core) {
+				const Scheduler *scheduler = Scheduler::get(core);
+				if (scheduler->isRunning())
+					Log::info("Core %u: %lu threads, %lu switches", core, scheduler->getThreadCount(),
+						scheduler->getSwitches());
+			}
+		} else if (front == "timer") {
+			unsigned long microseconds = 1000;
+			if (2 < pieces.size() || (pieces.size() == 2 && !Util::parseUlong(pieces[1], microseconds)))
+				Error("Usage: timer [microseconds]");
+
+			// The callback records when it actually ran, in the same clock as the deadline.
+			static uint64_t fired_at;
+			fired_at = 0;
+			Timers::Event event;
+			const uint64_t deadline = Timers::getMicroseconds() + microseconds;
+			Timers::getTimer().add(event, deadline, [](void *) {
+				__atomic_store_n(&fired_at, Timers::getMicroseconds(), __ATOMIC_RELEASE);
+			}, nullptr);
+
+			while (event.isPending())
+				if (!Scheduler::get()->yield())
+					asm volatile("wfi");
+			Log::info("Event for %lu us from now fired %lu us late", microseconds,
+				__atomic_load_n(&fired_at, __ATOMIC_ACQUIRE) - deadline);
+		} else if (front == "locks") {
+			if (pieces.size() == 2 && pieces[1] == "reset") {
+				for (TicketLock *lock = TicketLock::getFirst(); lock; lock = lock->getNext())
+					lock->resetStats();
+				Success("Reset lock statistics.");
+			}
+
+			if (pieces.size() != 1)
+				Error("Usage:\n- locks\n- locks reset");
+
+			Log::info("%-8s %12s %12s %14s (CNTVCT at %lu Hz)", "lock", "acquired", "contended", "spin ticks",
+				PMU::getCounterFrequency());
+			for (TicketLock *lock = TicketLock::getFirst(); lock; lock = lock->getNext()) {
+				const auto &stats = lock->getStats();
+				Log::info("%-8s %12lu %12lu %14lu", lock->getName(), stats.acquisitions, stats.contended,
+					stats.spinTicks);
+			}
+		} else if (front == "pager") {
+			unsigned long megabytes = 64;
+			if (2 < pieces.size()
+			    || (pieces.size() == 2 && (!Util::parseUlong(pieces[1], megabytes) || megabytes == 0)))
+				Error("Usage: pager [megabytes]");
+
+			Pager &pager = Kernel::getPager();
+			const size_t size = megabytes * MEGABYTE;
+			volatile char *region = static_cast<char *>(pager.reserve(size));
+			if (!region)
+				Error("Couldn't reserve %lu bytes.", size);
+
+			const size_t faults = pager.getFaults();
+			// Touching every fourth page should commit only a quarter of the reservation.
+			for (size_t offset = 0; offset < size; offset += 4 * PAGE_SIZE)
+				region[offset] = 1;
+			Log::info("Reserved %lu bytes at 0x%lx: %lu faults, %lu pages committed in total",
+				size, reinterpret_cast<uintptr_t>(region), pager.getFaults() - faults, pager.getCommittedPages());
+
+			pager.release(const_cast<char *>(region));
+			Log::info("After release: %lu bytes reserved, %lu pages committed", pager.getReservedBytes(),
+				pager.getCommittedPages());
+		} else if (front == "heap") {
+			auto usage = [] { Error("Usage:\n- heap\n- heap caches\n- heap stress"); };
+			if (2 < pieces.size())
+				return usage();
+
+			if (pieces.size() == 1) {
+				const auto &stats = global_memory->getStats();
+				Log::info("Allocated: %lu bytes (peak %lu), unallocated: %lu bytes", global_memory->getAllocated(),
+					stats.peak, global_memory->getUnallocated());
+				Log::info("Free blocks: %lu bytes, largest %lu bytes, fragmentation %.3f", global_memory->getFreeBytes(),
+					global_memory->getLargestFree(), global_memory->getFragmentation());
+				Log::info("Searches: %lu, average walk length %.2f", stats.searches,
+					stats.searches? static_cast<double>(stats.searchSteps) / stats.searches : 0.);
+				for (size_t index = 0; index <= Memory::Allocator::SMALL_CLASSES; ++index) {
+					if (stats.allocations[index] == 0 && stats.frees[index] == 0)
+						continue;
+					if (index < Memory::Allocator::SMALL_CLASSES)
+						Log::info("%5lu bytes: %lu allocations, %lu frees", (index + 1) * Memory::MEMORY_ALIGN,
+							stats.allocations[index], stats.frees[index]);
+					else
+						Log::info("      large: %lu allocations, %lu frees", stats.allocations[index], stats.frees[index]);
+				}
+				for (const auto zone: {Memory::Zone::DMA, Memory::Zone::Normal})
+					Log::info("%s zone: %lu of %lu pages free", Memory::zoneName(zone), Memory::getFreePages(zone),
+						Memory::getTotalPages(zone));
+				return true;
+			}
+
+			if (pieces[1] == "caches") {
+				for (unsigned core = 0; core < CORES; ++core) {
+					const auto &cache = Memory::getCoreCache(core);
+					const auto &stats = cache.getStats();
+					const size_t requests = stats.hits + stats.misses;
+					Log::info("Core %u: %lu hits, %lu misses (%lu%% hit rate), %lu refills, %lu drains, %lu bytes cached",
+						core, stats.hits, stats.misses, requests? stats.hits * 100 / requests : 0, stats.refills,
+						stats.drains, cache.getCachedBytes());
+				}
+				return true;
+			}
+
+			if (pieces[1] != "stress")
+				return usage();
+
+			// Runs on a private heap: blocks this small would otherwise be freed into the per-core caches and never reach
+			// Allocator::free. Frees every other block first so that the second pass has to coalesce with both
+			// neighbours. The cost per free should stay flat as the number of blocks grows.
+			constexpr size_t REGION_SIZE = 32 * MEGABYTE;
+			char *region = static_cast<char *>(Memory::allocatePageBytes(REGION_SIZE));
+			if (!region)
+				Error("Couldn't allocate a %lu-byte region.", REGION_SIZE);
+
+			for (const size_t count: {1'000ul, 5'000ul, 10'000ul, 25'000ul, 50'000ul}) {
+				Memory::Allocator heap(region, region + REGION_SIZE - 1, false);
+				heap.setBounds(region, region + REGION_SIZE - 1);
+				void **blocks = new void *[count];
+				if (!blocks) {
+					free(region);
+					Error("Couldn't allocate block array.");
+				}
+				for (size_t i = 0; i < count; ++i)
+					if (!(blocks[i] = heap.allocate(32 + (i % 8) * 32))) {
+						delete[] blocks;
+						free(region);
+						Error("Couldn't allocate block %lu of %lu.", i, count);
+					}
+				const uint64_t start = Timers::getSystemTimer();
+				for (size_t i = 0; i < count; i += 2)
+					heap.free(blocks[i]);
+				for (size_t i = 1; i < count; i += 2)
+					heap.free(blocks[i]);
+				const uint64_t elapsed = Timers::getSystemTimer() - start;
+				delete[] blocks;
+				Log::info("%6lu blocks: %lu ns/free, %lu free block bytes left, largest %lu", count,
+					elapsed * 1000 / count, heap.getFreeBytes(), heap.getLargestFree());
+			}
+			free(region);
+		} else if (front == "bench") {
+			auto usage = [] {
+				Error("Usage:\n- bench alloc [operations]\n- bench mem [max size]\n- bench tasks [megabytes]\n"
+					"- bench tlb [megabytes]");
+			};
+			if (pieces.size() < 2 || 3 < pieces.size()
+			    || (pieces[1] != "alloc" && pieces[1] != "mem" && pieces[1] != "tasks" && pieces[1] != "tlb"))
+				return usage();
+
+			if (pieces[1] == "tasks") {
+				unsigned long megabytes = 64;
+				if (pieces.size() == 3 && (!Util::parseUlong(pieces[2], megabytes) || megabytes == 0))
+					return usage();
+
+				// Checksums every page of a region on this core alone and then with the task pool.
+				const size_t pages = megabytes * MEGABYTE / PAGE_SIZE;
+				char *region = static_cast<char *>(Memory::allocatePageBytes(pages * PAGE_SIZE));
+				uint32_t *sums = new uint32_t[2 * pages];
+				if (!region || !sums) {
+					free(region);
+					delete[] sums;
+					Error("Couldn't allocate a %lu MiB region.", megabytes);
+				}
+
+				for (size_t i = 0; i < pages * PAGE_SIZE; ++i)
+					region[i] = static_cast<char>(i * 7 + i / PAGE_SIZE);
+
+				struct Job {
+					const char *region;
+					uint32_t *sums;
+				} job {region, sums};
+				auto checksum = [&job](size_t begin, size_t end) {
+					for (size_t page = begin; page < end; ++page)
+						job.sums[page] = Checksum::crc32(job.region + page * PAGE_SIZE, PAGE_SIZE);
+				};
+
+				uint64_t start = Timers::getSystemTimer();
+				checksum(0, pages);
+				const uint64_t serial = Timers::getSystemTimer() - start;
+
+				job.sums = sums + pages;
+				start = Timers::getSystemTimer();
+				Tasks::parallelFor(0, pages, checksum, 16);
+				const uint64_t parallel = Timers::getSystemTimer() - start;
+
+				const bool same = memcmp(sums, sums + pages, pages * sizeof(*sums)) == 0;
+				free(region);
+				delete[] sums;
+
+				if (!same)
+					Error("The parallel checksums differ from the serial ones.");
+				Log::info("CRC-32 of %lu pages: %lu us on one core, %lu us with the task pool on %u cores", pages,
+					serial, parallel, Cores::getOnlineCount());
+				return true;
+			}
+
+			if (pieces[1] == "tlb") {
+				unsigned long megabytes = 256;
+				if (pieces.size() == 3 && (!Util::parseUlong(pieces[2], megabytes) || megabytes == 0))
+					return usage();
+
+				const MMU::MappingStats &mapping = MMU::getMappingStats();
+				Log::info("Mapped by %lu 512 MiB blocks and %lu level 3 tables holding %lu contiguous 2 MiB runs and "
+					"%lu single pages", mapping.blocks, mapping.tables, mapping.contiguousRuns, mapping.pages);
+
+				if (PMU::getEventCounterCount() < 2)
+					Error("The PMU doesn't have enough event counters.");
+
+				const size_t size = megabytes * MEGABYTE;
+				volatile char *region = static_cast<char *>(Memory::allocatePageBytes(size));
+				if (!region)
+					Error("Couldn't allocate a %lu-byte region.", size);
+
+				PMU::startEventCounter(0, PMU::EVENT_L1D_TLB_REFILL);
+				PMU::startEventCounter(1, PMU::EVENT_L2D_TLB_REFILL);
+				const uint64_t start = PMU::getVirtualCount();
+				// One load per 4 KiB is enough to find out how many translations the region needs.
+				for (size_t offset = 0; offset < size; offset += 4096)
+					(void) region[offset];
+				const uint64_t elapsed = PMU::getVirtualCount() - start;
+				const uint32_t l1_refills = PMU::readEventCounter(0);
+				const uint32_t l2_refills = PMU::readEventCounter(1);
+				PMU::stopEventCounter(0);
+				PMU::stopEventCounter(1);
+				free(const_cast<char *>(region));
+
+				Log::info("%lu loads over %lu MiB: %u L1D TLB refills, %u L2 TLB refills, %lu CNTVCT ticks", size / 4096,
+					megabytes, l1_refills, l2_refills, elapsed);
+				return true;
+			}
+
+			if (pieces[1] == "mem") {
+				unsigned long max_size = Bench::MEMORY_MAX_SIZE;
+				if (pieces.size() == 3 && (!Util::parseUlong(pieces[2], max_size) || max_size == 0))
+					return usage();
+
+				char *region = static_cast<char *>(Memory::allocatePageBytes(Bench::MEMORY_REGION_SIZE));
+				if (!region)
+					Error("Couldn't allocate a %lu-byte region.", Bench::MEMORY_REGION_SIZE);
+
+				const bool cycles = PMU::enableCycleCounter();
+				if (cycles)
+					Log::info("Bytes per cycle at each source/destination alignment");
+				else
+					Log::info("No cycle counter; bytes per CNTVCT tick at %lu Hz at each source/destination alignment",
+						PMU::getCounterFrequency());
+
+				printf("%-8s %8s", "function", "size");
+				for (const auto &alignment: Bench::memoryAlignments)
+					printf(" %5u/%-2u", alignment.source, alignment.destination);
+				printf("\n");
+
+				Bench::benchMemory(region, max_size, cycles? PMU::getCycles : PMU::getVirtualCount,
+					[](const Bench::MemoryRow &row) {
+						printf("%-8s %8lu", row.function, row.size);
+						for (const double bytes: row.bytesPerTick)
+							printf(" %8.2f", bytes);
+						printf("\n");
+					});
+				free(region);
+				return true;
+			}
+
+			unsigned long operations = 100'000;
+			if (pieces.size() == 3 && (!Util::parseUlong(pieces[2], operations) || operations == 0))
+				return usage();
+
+			constexpr size_t REGION_SIZE = 64 * MEGABYTE;
+			char *region = static_cast<char *>(Memory::allocatePageBytes(REGION_SIZE));
+			if (!region)
+				Error("Couldn't allocate a %lu-byte region.", REGION_SIZE);
+
+			Bench::AllocatorResult results[Bench::ALLOCATOR_WORKLOADS];
+			Bench::benchAllocator(region, REGION_SIZE, operations, [] { return Timers::getSystemTimer() * 1000; },
+				results);
+			free(region);
+
+			for (const auto &result: results)
+				Log::info("%-18s %8lu ops, %lu ns/op, peak live %lu, footprint %lu, fragmentation %.3f", result.name,
+					result.operations, result.nanoseconds / result.operations, result.peakLive, result.footprint,
+					result.fragmentation);
 		} else if (front == "R") {
 			if (pieces.size() != 2 && pieces.size() != 3)
 				Error("Usage: R <address> [flag]");
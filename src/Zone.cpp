@@ -0,0 +1,118 @@
+#include "assert.h"
+#include "Log.h"
+#include "Memory.h"
+#include "Zone.h"
+#include "pi/PropertyTags.h"
+
+namespace Armaz::Memory {
+	static PageAllocator pageAllocators[ZONE_COUNT][ZONE_RANGES];
+	static size_t rangeCounts[ZONE_COUNT];
+	static Allocator *dmaHeap = nullptr;
+
+	static void addRange(Zone zone, uintptr_t start, uintptr_t end) {
+		// Each range needs at least one page for its page states and one to hand out.
+		if (end <= start || end - start < 2 * PAGE_SIZE)
+			return;
+
+		size_t &count = rangeCounts[static_cast<size_t>(zone)];
+		assert(count < ZONE_RANGES);
+		pageAllocators[static_cast<size_t>(zone)][count++].init(start, end);
+		Log::info("%s zone: 0x%lx to 0x%lx", zoneName(zone), start, end);
+	}
+
+	/** Decodes the amount of installed RAM from a new-style board revision. */
+	uintptr_t getRAMEnd() {
+		PropertyTagBoard board;
+		if (PropertyTags::getTag(PROPTAG_GET_BOARD_REVISION, &board, sizeof(board)) && (board.board & (1 << 23)))
+			return (256ul * MEGABYTE) << ((board.board >> 20) & 7);
+		return GIGABYTE;
+	}
+
+	/** Tries successively smaller runs until one fits. */
+	static char * allocateHeapRegion(size_t order, Zone zone, size_t &size) {
+		for (;;) {
+			if (char *region = static_cast<char *>(allocatePages(order, zone))) {
+				size = static_cast<size_t>(PAGE_SIZE) << order;
+				return region;
+			}
+			if (order-- == 0)
+				return nullptr;
+		}
+	}
+
+	bool initZones(Allocator &heap, Allocator &dma_heap) {
+		PropertyTagMemory arm_memory;
+		if (!PropertyTags::getTag(PROPTAG_GET_ARM_MEMORY, &arm_memory, sizeof(arm_memory)))
+			return false;
+
+		const uintptr_t low_end = arm_memory.baseAddress + arm_memory.size;
+		const uintptr_t ram_end = getRAMEnd();
+		auto min = [](uintptr_t a, uintptr_t b) { return a < b? a : b; };
+
+		addRange(Zone::DMA, MEM_HEAP_START, low_end);
+		addRange(Zone::DMA, MEM_HIGHMEM_START, min(ram_end, DMA_ZONE_END));
+		addRange(Zone::Normal, DMA_ZONE_END, min(ram_end, PERIPHERAL_HOLE_START));
+		addRange(Zone::Normal, PERIPHERAL_HOLE_END, ram_end);
+
+		size_t size;
+		char *region = allocateHeapRegion(DMA_HEAP_ORDER, Zone::DMA, size);
+		if (!region)
+			return false;
+		dma_heap.setBounds(region, region + size - 1);
+		dmaHeap = &dma_heap;
+
+		if (!(region = allocateHeapRegion(HEAP_ORDER, Zone::Normal, size)))
+			return false;
+		heap.setBounds(region, region + size - 1);
+		return true;
+	}
+
+	void * allocatePages(size_t order, Zone zone) {
+		for (size_t index = static_cast<size_t>(zone) + 1; 0 < index--;)
+			for (size_t range = 0; range < rangeCounts[index]; ++range)
+				if (void *run = pageAllocators[index][range].allocate(order))
+					return run;
+		return nullptr;
+	}
+
+	void * allocatePageBytes(size_t bytes, Zone zone) {
+		const size_t order = PageAllocator::orderFor(bytes);
+		if (PageAllocator::MAX_ORDER < order)
+			return nullptr;
+		return allocatePages(order, zone);
+	}
+
+	PageAllocator * findPages(const void *ptr) {
+		for (size_t index = 0; index < ZONE_COUNT; ++index)
+			for (size_t range = 0; range < rangeCounts[index]; ++range)
+				if (pageAllocators[index][range].contains(ptr))
+					return &pageAllocators[index][range];
+		return nullptr;
+	}
+
+	Allocator * getDMAHeap() {
+		return dmaHeap;
+	}
+
+	size_t getFreePages(Zone zone) {
+		size_t out = 0;
+		for (size_t range = 0; range < rangeCounts[static_cast<size_t>(zone)]; ++range)
+			out += pageAllocators[static_cast<size_t>(zone)][range].getFreePages();
+		return out;
+	}
+
+	size_t getTotalPages(Zone zone) {
+		size_t out = 0;
+		for (size_t range = 0; range < rangeCounts[static_cast<size_t>(zone)]; ++range)
+			out += pageAllocators[static_cast<size_t>(zone)][range].getTotalPages();
+		return out;
+	}
+
+	const char * zoneName(Zone zone) {
+		switch (zone) {
+			case Zone::DMA:    return "DMA";
+			case Zone::Normal: return "Normal";
+			default:           return "?";
+		}
+	}
+}
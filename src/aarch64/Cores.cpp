@@ -0,0 +1,116 @@
+#include "assert.h"
+#include "Config.h"
+#include "Scheduler.h"
+#include "Tasks.h"
+#include "aarch64/ARM.h"
+#include "aarch64/Cores.h"
+#include "aarch64/MMU.h"
+#include "aarch64/Spinlock.h"
+#include "aarch64/Synchronize.h"
+#include "aarch64/Timer.h"
+#include "interrupts/IRQ.h"
+
+extern "C" void _start_secondary();
+
+namespace Armaz::Cores {
+	namespace {
+		/** Each core's slot gets a cache line of its own so that polling it doesn't disturb the others. */
+		struct alignas(L1_DATA_CACHE_LINE_LENGTH) Slot {
+			bool online = false;
+			bool busy = false;
+			Work work = nullptr;
+			void *argument = nullptr;
+		};
+
+		Slot slots[CORES];
+	}
+
+	unsigned start() {
+#ifdef ARM_ALLOW_MULTI_CORE
+		static bool started = false;
+		assert(ARM::getCore() == 0);
+		if (started || !MMU::enabled)
+			return getOnlineCount();
+		started = true;
+		__atomic_store_n(&slots[0].online, true, __ATOMIC_RELEASE);
+
+		Spinlock::enable();
+
+		for (unsigned core = 1; core < CORES; ++core) {
+			volatile uint64_t *entry = reinterpret_cast<volatile uint64_t *>(SPIN_TABLE_BASE + 8 * core);
+			*entry = reinterpret_cast<uintptr_t>(&_start_secondary);
+			// The parked cores read the slot with their caches off.
+			cleanRange(const_cast<uint64_t *>(entry), sizeof(*entry));
+		}
+
+		dataSyncBarrier();
+		asm volatile("sev");
+
+		for (unsigned core = 1; core < CORES; ++core) {
+			const uint64_t deadline = Timers::getSystemTimer() + START_TIMEOUT_US;
+			while (!isOnline(core) && Timers::getSystemTimer() < deadline);
+		}
+#endif
+		return getOnlineCount();
+	}
+
+	void runSecondary() {
+		const unsigned core = ARM::getCore();
+		// This has to come before anything that might touch shared data or use unaligned accesses.
+		MMU::enable();
+		Interrupts::initCore();
+		Timers::getTimer().init();
+		Scheduler *scheduler = Scheduler::get();
+		scheduler->init();
+
+		Slot &slot = slots[core];
+		__atomic_store_n(&slot.online, true, __ATOMIC_RELEASE);
+		dataSyncBarrier();
+		asm volatile("sev");
+
+		for (;;) {
+			Work work = __atomic_load_n(&slot.work, __ATOMIC_ACQUIRE);
+			if (!work) {
+				// Idle time goes to stealing queued tasks, then to the threads spawned on this core.
+				if (!Tasks::runOne() && !scheduler->yield())
+					asm volatile("wfe");
+				continue;
+			}
+
+			work(slot.argument);
+			__atomic_store_n(&slot.work, nullptr, __ATOMIC_RELAXED);
+			__atomic_store_n(&slot.busy, false, __ATOMIC_RELEASE);
+		}
+	}
+
+	bool isOnline(unsigned core) {
+		return core < CORES && __atomic_load_n(&slots[core].online, __ATOMIC_ACQUIRE);
+	}
+
+	unsigned getOnlineCount() {
+		unsigned count = 0;
+		for (unsigned core = 0; core < CORES; ++core)
+			count += isOnline(core);
+		return count;
+	}
+
+	bool run(unsigned core, Work work, void *argument) {
+		if (core == 0 || !isOnline(core) || !work)
+			return false;
+
+		Slot &slot = slots[core];
+		bool expected = false;
+		if (!__atomic_compare_exchange_n(&slot.busy, &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return false;
+
+		slot.argument = argument;
+		__atomic_store_n(&slot.work, work, __ATOMIC_RELEASE);
+		dataSyncBarrier();
+		asm volatile("sev");
+		return true;
+	}
+
+	bool isIdle(unsigned core) {
+		return core < CORES && !__atomic_load_n(&slots[core].busy, __ATOMIC_ACQUIRE);
+	}
+}
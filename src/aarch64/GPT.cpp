@@ -1,3 +1,6 @@
+#include <stddef.h>
+
+#include "Checksum.h"
 #include "lib/printf.h"
 #include "pi/UART.h"
 #include "storage/GPT.h"
@@ -24,6 +27,29 @@ namespace Armaz::GPT {
 			|| node[3] || node[4] || node[5];
 	}
 
+	static_assert(offsetof(Header, partitionsCRC32) + sizeof(uint32_t) == Header::MIN_SIZE);
+
+	bool Header::validate() const {
+		if (signature != SIGNATURE || headerSize < MIN_SIZE || MAX_SIZE < headerSize)
+			return false;
+
+		// The CRC covers all headerSize bytes with only the CRC field itself zeroed.
+		static const uint8_t zeros[sizeof(crc32)] = {};
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(this);
+		constexpr size_t crc_offset = offsetof(Header, crc32);
+		constexpr size_t after_crc = crc_offset + sizeof(crc32);
+
+		uint32_t crc = Checksum::crc32(bytes, crc_offset);
+		crc = Checksum::crc32(zeros, sizeof(zeros), crc);
+		crc = Checksum::crc32(bytes + after_crc, headerSize - after_crc, crc);
+		return crc == crc32;
+	}
+
+	bool Header::validatePartitions(const void *entries) const {
+		const size_t size = static_cast<size_t>(partitionCount) * partitionEntrySize;
+		return Checksum::crc32(entries, size) == partitionsCRC32;
+	}
+
 	void PartitionEntry::printName(bool newline) {
 		for (unsigned i = 0; i < 36; ++i) {
 			if (!name[i])
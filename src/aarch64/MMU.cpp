@@ -1,18 +1,42 @@
 #include <cstdint>
 
+#include "assert.h"
 #include "aarch64/MMU.h"
 #include "aarch64/SysRegs.h"
 #include "aarch64/Synchronize.h"
+#include "aarch64/TranslationTable.h"
 
 namespace Armaz::MMU {
+	bool enabled = false;
+	static TranslationTable kernelTable;
+
+	bool init(uintptr_t ram_end) {
+		if (!kernelTable.init(ram_end))
+			return false;
+		enable();
+		return true;
+	}
+
 	void enable() {
+		assert(kernelTable.getBase());
+		asm volatile("msr mair_el1, %0" :: "r"(MAIR_VALUE));
+		asm volatile("msr ttbr0_el1, %0" :: "r"(kernelTable.getBase()));
+		asm volatile("msr tcr_el1, %0" :: "r"(TCR_EL1_VALUE));
+		instructionSyncBarrier();
+		asm volatile("tlbi vmalle1" ::: "memory");
+		dataSyncBarrier();
+		instructionSyncBarrier();
+
 		uint32_t sctlr;
 		asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
 		sctlr = (sctlr & ~(SCTLR_EL1_WXN | SCTLR_EL1_A)) | SCTLR_EL1_I | SCTLR_EL1_C | SCTLR_EL1_M;
 		asm volatile("msr sctlr_el1, %0" :: "r"(sctlr));
+		instructionSyncBarrier();
+		enabled = true;
 	}
 
 	void disable() {
+		enabled = false;
 		uint32_t sctlr;
 		asm volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
 		sctlr &= ~(SCTLR_EL1_M | SCTLR_EL1_C);
@@ -25,4 +49,23 @@ namespace Armaz::MMU {
 		dataSyncBarrier();
 		instructionSyncBarrier();
 	}
+
+	const MappingStats & getMappingStats() {
+		return kernelTable.getStats();
+	}
+
+	bool mapPage(uintptr_t virtual_address, uintptr_t physical_address) {
+		return kernelTable.mapPage(virtual_address, physical_address);
+	}
+
+	uintptr_t unmapPage(uintptr_t virtual_address) {
+		return kernelTable.unmapPage(virtual_address);
+	}
+
+	bool isMapped(uintptr_t address) {
+		uint64_t par;
+		asm volatile("at s1e1r, %1; isb; mrs %0, par_el1" : "=r"(par) : "r"(address));
+		// PAR_EL1.F is set if the translation faulted.
+		return !(par & 1);
+	}
 }
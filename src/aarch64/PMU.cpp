@@ -0,0 +1,61 @@
+#include "aarch64/PMU.h"
+
+namespace Armaz::PMU {
+	static bool hasPMU() {
+		uint64_t dfr0;
+		asm volatile("mrs %0, id_aa64dfr0_el1" : "=r"(dfr0));
+		const uint64_t version = (dfr0 >> 8) & 0xf;
+		// 0 means there's no PMU and 0xf means an IMPLEMENTATION DEFINED one.
+		return version != 0 && version != 0xf;
+	}
+
+	bool enableCycleCounter() {
+		if (!hasPMU())
+			return false;
+
+		uint64_t pmcr;
+		asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+		asm volatile("msr pmcr_el0, %0" :: "r"(pmcr | PMCR_E | PMCR_C | PMCR_LC));
+		asm volatile("msr pmccfiltr_el0, %0" :: "r"(0ul));
+		asm volatile("msr pmcntenset_el0, %0" :: "r"(PMCNTENSET_C));
+
+		const uint64_t start = getCycles();
+		for (int i = 0; i < 1000; ++i)
+			asm volatile("nop");
+		return getCycles() != start;
+	}
+
+	unsigned getEventCounterCount() {
+		if (!hasPMU())
+			return 0;
+		uint64_t pmcr;
+		asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+		return (pmcr >> PMCR_N_SHIFT) & PMCR_N_MASK;
+	}
+
+	bool startEventCounter(unsigned counter, uint16_t event) {
+		if (getEventCounterCount() <= counter)
+			return false;
+
+		uint64_t pmcr;
+		asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+		asm volatile("msr pmcr_el0, %0" :: "r"(pmcr | PMCR_E));
+		asm volatile("msr pmselr_el0, %0; isb" :: "r"(static_cast<uint64_t>(counter)));
+		// Leaving the filter bits clear counts at EL0 and EL1.
+		asm volatile("msr pmxevtyper_el0, %0" :: "r"(static_cast<uint64_t>(event)));
+		asm volatile("msr pmxevcntr_el0, %0" :: "r"(0ul));
+		asm volatile("msr pmcntenset_el0, %0; isb" :: "r"(1ul << counter));
+		return true;
+	}
+
+	void stopEventCounter(unsigned counter) {
+		asm volatile("msr pmcntenclr_el0, %0; isb" :: "r"(1ul << counter));
+	}
+
+	uint32_t readEventCounter(unsigned counter) {
+		uint64_t count;
+		asm volatile("msr pmselr_el0, %1; isb; mrs %0, pmxevcntr_el0"
+			: "=r"(count) : "r"(static_cast<uint64_t>(counter)));
+		return count;
+	}
+}
@@ -1,6 +1,7 @@
 // Credit: https://github.com/rsta2/circle
 
 #include "assert.h"
+#include "aarch64/PMU.h"
 #include "aarch64/Spinlock.h"
 #include "aarch64/Synchronize.h"
 
@@ -60,4 +61,62 @@ namespace Armaz {
 
 	void Spinlock::enable() {}
 #endif
+
+	TicketLock *TicketLock::first = nullptr;
+
+	TicketLock::TicketLock(Level level_, const char *name_): level(level_), name(name_) {
+		// Locks are constructed before the other cores start, so the list needs no locking.
+		if (name) {
+			next = first;
+			first = this;
+		}
+	}
+
+	void TicketLock::acquire() {
+		if (level == Level::IRQ || level == Level::FIQ)
+			enterCritical(level);
+
+#ifdef ARM_ALLOW_MULTI_CORE
+		if (Spinlock::isEnabled()) {
+			const uint32_t ticket = __atomic_fetch_add(&nextTicket, 1, __ATOMIC_RELAXED);
+			if (__atomic_load_n(&owner, __ATOMIC_ACQUIRE) != ticket) {
+				const uint64_t start = name? PMU::getVirtualCount() : 0;
+				// The exclusive load arms the monitor, so the store that passes the lock on wakes this core up.
+				uint32_t serving;
+				asm volatile(
+					"sevl\n"
+					"1: wfe\n"
+					"ldaxrh %w0, [%1]\n"
+					"cmp %w0, %w2\n"
+					"b.ne 1b\n"
+				: "=&r"(serving) : "r"(&owner), "r"(ticket) : "cc", "memory");
+				if (name) {
+					++stats.contended;
+					stats.spinTicks += PMU::getVirtualCount() - start;
+				}
+			}
+		}
+#endif
+
+		if (name)
+			++stats.acquisitions;
+	}
+
+	void TicketLock::release() {
+#ifdef ARM_ALLOW_MULTI_CORE
+		if (Spinlock::isEnabled()) {
+			__atomic_store_n(&owner, static_cast<uint16_t>(owner + 1), __ATOMIC_RELEASE);
+			asm volatile("sev");
+		}
+#endif
+
+		if (level == Level::IRQ || level == Level::FIQ)
+			leaveCritical();
+	}
+
+	void TicketLock::resetStats() {
+		acquire();
+		stats = {};
+		release();
+	}
 }
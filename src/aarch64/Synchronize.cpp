@@ -65,6 +65,50 @@ namespace Armaz {
 		dataSyncBarrier();
 	}
 
+	size_t getDataCacheLineSize() {
+		uint64_t ctr;
+		asm volatile("mrs %0, ctr_el0" : "=r"(ctr));
+		// DminLine is the log2 of the number of words in the smallest line.
+		return 4ul << ((ctr >> 16) & 0xf);
+	}
+
+	void cleanRange(const void *start, size_t size) {
+		const uintptr_t line = getDataCacheLineSize();
+		const uintptr_t end = reinterpret_cast<uintptr_t>(start) + size;
+		for (uintptr_t address = reinterpret_cast<uintptr_t>(start) & ~(line - 1); address < end; address += line)
+			asm volatile("dc cvac, %0" :: "r"(address) : "memory");
+		dataSyncBarrier();
+	}
+
+	void invalidateRange(const void *start, size_t size) {
+		const uintptr_t line = getDataCacheLineSize();
+		uintptr_t address = reinterpret_cast<uintptr_t>(start);
+		uintptr_t end = address + size;
+
+		if (address & (line - 1)) {
+			address &= ~(line - 1);
+			asm volatile("dc civac, %0" :: "r"(address) : "memory");
+			address += line;
+		}
+
+		if (address < end && (end & (line - 1))) {
+			end &= ~(line - 1);
+			asm volatile("dc civac, %0" :: "r"(end) : "memory");
+		}
+
+		for (; address < end; address += line)
+			asm volatile("dc ivac, %0" :: "r"(address) : "memory");
+		dataSyncBarrier();
+	}
+
+	void cleanInvalidateRange(const void *start, size_t size) {
+		const uintptr_t line = getDataCacheLineSize();
+		const uintptr_t end = reinterpret_cast<uintptr_t>(start) + size;
+		for (uintptr_t address = reinterpret_cast<uintptr_t>(start) & ~(line - 1); address < end; address += line)
+			asm volatile("dc civac, %0" :: "r"(address) : "memory");
+		dataSyncBarrier();
+	}
+
 	void syncDataAndInstructionCache() {
 		cleanDataCache();
 
@@ -122,7 +166,7 @@ namespace Armaz {
 		flags[core][criticalLevels[core]] = current_flags;
 		criticalLevels[core] = criticalLevels[core] + 1;
 
-		if (targetLevel == Level::IRQ)
+		if (level == Level::IRQ)
 			Interrupts::enableFIQs();
 
 		dataMemBarrier();
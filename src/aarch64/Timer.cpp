@@ -13,7 +13,10 @@
  * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
 #include "assert.h"
+#include "Scheduler.h"
+#include "aarch64/ARM.h"
 #include "aarch64/MMIO.h"
+#include "aarch64/Spinlock.h"
 #include "aarch64/Synchronize.h"
 #include "aarch64/Timer.h"
 #include "board/BCM2711int.h"
@@ -22,7 +25,46 @@
 #include "pi/UART.h"
 
 namespace Armaz::Timers {
-	Timer timer;
+	static Timer timers[CORES];
+	/** Keeps two cores from both connecting the shared handler. */
+	static Spinlock connectLock;
+	/** Microseconds per generic timer tick as a reduced fraction, which both conversions below use so that they're
+	 *  exact inverses of each other. It's the same on every core, so it's worked out once on the boot core. */
+	static uint64_t scaleMicroseconds = 0;
+	static uint64_t scaleTicks = 0;
+
+	void initScales() {
+		uint64_t cntfrq;
+		asm volatile("mrs %0, cntfrq_el0" : "=r"(cntfrq));
+		uint64_t a = 1'000'000, b = cntfrq;
+		while (b) {
+			const uint64_t remainder = a % b;
+			a = b;
+			b = remainder;
+		}
+		scaleMicroseconds = 1'000'000 / a;
+		scaleTicks = cntfrq / a;
+	}
+
+	/** Rounded down. The quotient and remainder are scaled separately so that nothing overflows. */
+	static uint64_t toMicroseconds(uint64_t ticks) {
+		return ticks / scaleTicks * scaleMicroseconds + ticks % scaleTicks * scaleMicroseconds / scaleTicks;
+	}
+
+	/** The first tick at which toMicroseconds reaches the given time, so the timer never fires before a deadline and
+	 *  getMicroseconds has always reached it by the time the interrupt is taken. */
+	static uint64_t toTicks(uint64_t microseconds) {
+		return microseconds / scaleMicroseconds * scaleTicks
+			+ (microseconds % scaleMicroseconds * scaleTicks + scaleMicroseconds - 1) / scaleMicroseconds;
+	}
+
+	static void schedulerTick(void *) {
+		Scheduler::get()->tick();
+	}
+
+	Timer & getTimer() {
+		return timers[ARM::getCore()];
+	}
 
 	uint64_t getSystemTimer() {
 		uint32_t high, low;
@@ -45,6 +87,12 @@ namespace Armaz::Timers {
 		while (getSystemTimer() < time + count);
 	}
 
+	uint64_t getMicroseconds() {
+		uint64_t cntpct;
+		asm volatile("isb; mrs %0, cntpct_el0" : "=r"(cntpct));
+		return toMicroseconds(cntpct);
+	}
+
 	unsigned getClockTicks (void) {
 #ifndef USE_PHYSICAL_COUNTER
 		peripheralEntry();
@@ -64,37 +112,179 @@ namespace Armaz::Timers {
 		if (connected)
 			return;
 		connected = true;
-		Interrupts::connect(ARM_IRQLOCAL0_CNTPNS, handler, this);
-		uint64_t cntfrq;
-		asm volatile("mrs %0, cntfrq_el0" : "=r"(cntfrq));
-		assert(cntfrq % HZ == 0);
-		clockTicksPerHzTick = cntfrq / HZ;
+		connectLock.acquire();
+		if (Interrupts::handlers[ARM_IRQLOCAL0_CNTPNS])
+			Interrupts::enable(ARM_IRQLOCAL0_CNTPNS);
+		else
+			Interrupts::connect(ARM_IRQLOCAL0_CNTPNS, handler, nullptr);
+		connectLock.release();
 
-		uint64_t cntpct;
-		asm volatile("mrs %0, cntpct_el0" : "=r"(cntpct));
-		asm volatile("msr cntp_cval_el0, %0" :: "r"(cntpct + clockTicksPerHzTick));
-		asm volatile("msr cntp_ctl_el0, %0" :: "r"(1));
+		constexpr uint64_t tick_period = 1'000'000 / HZ;
+		wheelTime = getMicroseconds();
+		add(tickEvent, wheelTime + tick_period, schedulerTick, nullptr, tick_period);
 	}
 
 	void Timer::handler() {
-		// static unsigned i = 0;
-		// printf("Timer. %u\n", ++i);
-		// printf("Timer. 0x%llx\n", lastlink);
-
-		uint64_t cval;
-		asm volatile("mrs %0, cntp_cval_el0" : "=r"(cval));
-		asm volatile("msr cntp_cval_el0, %0" :: "r"(cval + clockTicksPerHzTick));
+		expire(getMicroseconds());
+		program();
 	}
 
-	void Timer::handler(void *param) {
-		assert(param);
-		((Timer *) param)->handler();
+	void Timer::handler(void *) {
+		getTimer().handler();
 	}
 
 	void Timer::disconnect() {
 		if (!connected)
 			return;
-		Interrupts::disconnect(ARM_IRQLOCAL0_CNTPNS);
+		cancel(tickEvent);
+		// The handler stays connected for the other cores.
+		Interrupts::disable(ARM_IRQLOCAL0_CNTPNS);
+		asm volatile("msr cntp_ctl_el0, %0" :: "r"(0ul));
 		connected = false;
 	}
+
+	bool Timer::add(Event &event, uint64_t deadline, Event::Callback callback, void *argument, uint64_t period) {
+		enterCritical(Level::IRQ);
+		if (event.pending) {
+			leaveCritical();
+			return false;
+		}
+
+		if (wheelTime == 0)
+			wheelTime = getMicroseconds();
+
+		event.deadline = deadline;
+		event.period = period;
+		event.callback = callback;
+		event.argument = argument;
+		event.pending = true;
+		insert(event);
+		program();
+		leaveCritical();
+		return true;
+	}
+
+	bool Timer::cancel(Event &event) {
+		enterCritical(Level::IRQ);
+		const bool pending = event.pending;
+		if (pending) {
+			unlink(event);
+			event.pending = false;
+			program();
+		}
+		leaveCritical();
+		return pending;
+	}
+
+	void Timer::insert(Event &event) {
+		uint64_t deadline = event.deadline < wheelTime? wheelTime : event.deadline;
+		uint64_t delta = deadline - wheelTime;
+		if (WHEEL_RANGE <= delta) {
+			// It goes in the top level's last slot and gets put back up there when that slot comes due.
+			delta = WHEEL_RANGE - 1;
+			deadline = wheelTime + delta;
+		}
+
+		// The level whose slots are just small enough for the event to be at least one slot ahead.
+		const unsigned level = delta? (63 - __builtin_clzl(delta)) / WHEEL_SLOT_BITS : 0;
+		const unsigned slot = (deadline >> (level * WHEEL_SLOT_BITS)) % WHEEL_SLOTS;
+		event.level = level;
+		event.slot = slot;
+		event.previous = nullptr;
+		event.next = wheel[level][slot];
+		if (event.next)
+			event.next->previous = &event;
+		wheel[level][slot] = &event;
+		occupied[level] |= 1ul << slot;
+	}
+
+	void Timer::unlink(Event &event) {
+		Event *&head = event.level == FIRING? firing : wheel[event.level][event.slot];
+		if (event.previous)
+			event.previous->next = event.next;
+		else
+			head = event.next;
+		if (event.next)
+			event.next->previous = event.previous;
+		if (event.level != FIRING && !head)
+			occupied[event.level] &= ~(1ul << event.slot);
+		event.previous = event.next = nullptr;
+	}
+
+	Event * Timer::takeSlot(unsigned level, unsigned slot) {
+		Event *list = wheel[level][slot];
+		wheel[level][slot] = nullptr;
+		occupied[level] &= ~(1ul << slot);
+		return list;
+	}
+
+	uint64_t Timer::nextDue() const {
+		uint64_t earliest = NO_DEADLINE;
+		for (unsigned level = 0; level < WHEEL_LEVELS; ++level) {
+			if (!occupied[level])
+				continue;
+
+			const unsigned shift = level * WHEEL_SLOT_BITS;
+			const uint64_t granule = 1ul << shift;
+			// A slot comes due at the start of its next turn, which is now only if the wheel is exactly at its start.
+			const bool aligned = (wheelTime & (granule - 1)) == 0;
+			const unsigned first = ((wheelTime >> shift) + !aligned) % WHEEL_SLOTS;
+			const uint64_t start = aligned? wheelTime : (wheelTime & ~(granule - 1)) + granule;
+			const uint64_t rotated = first? occupied[level] >> first | occupied[level] << (64 - first) : occupied[level];
+			const uint64_t due = start + __builtin_ctzl(rotated) * granule;
+			if (due < earliest)
+				earliest = due;
+		}
+		return earliest;
+	}
+
+	void Timer::expire(uint64_t now) {
+		uint64_t due;
+		while ((due = nextDue()) <= now) {
+			wheelTime = due;
+
+			for (unsigned level = WHEEL_LEVELS - 1; 0 < level; --level) {
+				const unsigned shift = level * WHEEL_SLOT_BITS;
+				if (wheelTime & ((1ul << shift) - 1))
+					continue;
+				Event *event = takeSlot(level, (wheelTime >> shift) % WHEEL_SLOTS);
+				while (event) {
+					Event *next = event->next;
+					insert(*event);
+					event = next;
+				}
+			}
+
+			firing = takeSlot(0, wheelTime % WHEEL_SLOTS);
+			for (Event *event = firing; event; event = event->next)
+				event->level = FIRING;
+			++wheelTime;
+
+			// Callbacks can cancel events that are still waiting to fire here, so they're taken off one at a time.
+			while (Event *event = firing) {
+				unlink(*event);
+				event->pending = false;
+				if (event->period) {
+					event->deadline += event->period;
+					event->pending = true;
+					insert(*event);
+				}
+				event->callback(event->argument);
+			}
+		}
+
+		// Nothing is due before now + 1, so new events can be placed relative to the present.
+		if (wheelTime <= now)
+			wheelTime = now + 1;
+	}
+
+	void Timer::program() {
+		const uint64_t due = nextDue();
+		if (due == NO_DEADLINE) {
+			asm volatile("msr cntp_ctl_el0, %0" :: "r"(0ul));
+			return;
+		}
+		asm volatile("msr cntp_cval_el0, %0" :: "r"(toTicks(due)));
+		asm volatile("msr cntp_ctl_el0, %0" :: "r"(1ul));
+	}
 }
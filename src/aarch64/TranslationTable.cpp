@@ -0,0 +1,246 @@
+// Credit: https://github.com/rsta2/circle/blob/master/lib/translationtable64.cpp
+
+#include "assert.h"
+#include "Memory.h"
+#include "Zone.h"
+#include "util.h"
+#include "aarch64/MMU.h"
+#include "aarch64/Synchronize.h"
+#include "aarch64/TranslationTable.h"
+#include "pi/MemoryMap.h"
+
+extern "C" char __text_end[];
+
+namespace Armaz::MMU {
+	static_assert(LEVEL3_PAGE_SIZE == PAGE_SIZE, "Each table is expected to fill exactly one page");
+
+	static bool overlaps(uintptr_t start, uintptr_t end, uintptr_t other_start, uintptr_t other_end) {
+		return start < other_end && other_start < end;
+	}
+
+	TranslationTable::Kind TranslationTable::classify(uintptr_t address) const {
+		if (MEM_COHERENT_REGION <= address && address < MEM_HEAP_START)
+			return Kind::Coherent;
+		if (Memory::PERIPHERAL_HOLE_START <= address && address < Memory::PERIPHERAL_HOLE_END)
+			return Kind::Device;
+		if (MEM_PCIE_RANGE_START <= address && address < MEM_PCIE_RANGE_START + MEM_PCIE_RANGE_SIZE)
+			return Kind::Device;
+		if (address < ramEnd)
+			return Kind::Normal;
+		return Kind::Unmapped;
+	}
+
+	bool TranslationTable::isUniform(uintptr_t start, uintptr_t end) const {
+		// classify and the executable check only change at these addresses.
+		const uintptr_t boundaries[] {
+			MEM_COHERENT_REGION, MEM_HEAP_START,
+			Memory::PERIPHERAL_HOLE_START, Memory::PERIPHERAL_HOLE_END,
+			MEM_PCIE_RANGE_START, MEM_PCIE_RANGE_START + MEM_PCIE_RANGE_SIZE,
+			ramEnd, textEnd,
+		};
+
+		for (const uintptr_t boundary: boundaries)
+			if (start < boundary && boundary < end)
+				return false;
+		return true;
+	}
+
+	template <typename D>
+	void TranslationTable::setAttributes(D &descriptor, Kind kind, bool executable) {
+		descriptor.ap = ATTRIB_AP_RW_EL1;
+		descriptor.af = 1;
+		descriptor.uxn = 1;
+
+		switch (kind) {
+			case Kind::Normal:
+				descriptor.attrIndex = ATTRINDX_NORMAL;
+				descriptor.sh = ATTRIB_SH_INNER_SHAREABLE;
+				descriptor.pxn = !executable;
+				break;
+			case Kind::Coherent:
+				descriptor.attrIndex = ATTRINDX_COHERENT;
+				descriptor.sh = ATTRIB_SH_INNER_SHAREABLE;
+				descriptor.pxn = 1;
+				break;
+			default:
+				descriptor.attrIndex = ATTRINDX_DEVICE;
+				descriptor.sh = ATTRIB_SH_OUTER_SHAREABLE;
+				descriptor.pxn = 1;
+				break;
+		}
+	}
+
+	uint64_t TranslationTable::describeBlock(uintptr_t address) const {
+		const Kind kind = classify(address);
+		if (kind == Kind::Unmapped)
+			return 0;
+
+		Level2Descriptor descriptor {};
+		Level2BlockDescriptor &block = descriptor.block;
+		block.value01 = 1;
+		block.outputAddress = address >> 29;
+		setAttributes(block, kind, address < textEnd);
+		return descriptor.value;
+	}
+
+	uint64_t TranslationTable::describePage(uintptr_t address) const {
+		const Kind kind = classify(address);
+		if (kind == Kind::Unmapped)
+			return 0;
+
+		// The descriptor is built in a local and stored with one 64-bit write rather than field by field.
+		Level3Descriptor descriptor {};
+		Level3PageDescriptor &page = descriptor.page;
+		page.value11 = 3;
+		page.outputAddress = address >> 16;
+		setAttributes(page, kind, address < textEnd);
+		return descriptor.value;
+	}
+
+	void TranslationTable::markContiguous(uint64_t *table) {
+		for (size_t first = 0; first < TABLE_ENTRIES; first += CONTIGUOUS_PAGES) {
+			if (!table[first])
+				continue;
+
+			// The mapping is an identity one, so a run is uniform exactly when only the output address changes.
+			bool uniform = true;
+			for (size_t i = 1; i < CONTIGUOUS_PAGES && uniform; ++i)
+				uniform = table[first + i] == table[first] + i * LEVEL3_PAGE_SIZE;
+
+			if (!uniform) {
+				for (size_t i = 0; i < CONTIGUOUS_PAGES; ++i)
+					stats.pages += table[first + i] != 0;
+				continue;
+			}
+
+			for (size_t i = 0; i < CONTIGUOUS_PAGES; ++i) {
+				Level3Descriptor descriptor;
+				descriptor.value = table[first + i];
+				descriptor.page.continous = 1;
+				table[first + i] = descriptor.value;
+			}
+			++stats.contiguousRuns;
+		}
+	}
+
+	uint64_t * TranslationTable::createLevel3(uintptr_t base) {
+		uint64_t *table = static_cast<uint64_t *>(Memory::allocatePages(0));
+		if (!table)
+			return nullptr;
+
+		for (size_t entry = 0; entry < TABLE_ENTRIES; ++entry)
+			table[entry] = describePage(base + entry * LEVEL3_PAGE_SIZE);
+
+		markContiguous(table);
+		return table;
+	}
+
+	void TranslationTable::release() {
+		for (size_t entry = 0; entry < LEVEL2_ENTRIES_USED; ++entry)
+			if (level2[entry]) {
+				Level2Descriptor descriptor;
+				descriptor.value = level2[entry];
+				if (descriptor.table.value11 == 3)
+					free(reinterpret_cast<void *>(static_cast<uintptr_t>(descriptor.table.tableAddress) << 16));
+			}
+		free(level2);
+		level2 = nullptr;
+		stats = {};
+	}
+
+	bool TranslationTable::init(uintptr_t ram_end) {
+		ramEnd = ram_end;
+		// The page holding the end of the text also holds the start of the read-only data, so it stays executable.
+		textEnd = Util::upalign(reinterpret_cast<uintptr_t>(__text_end), LEVEL3_PAGE_SIZE);
+
+		level2 = static_cast<uint64_t *>(Memory::allocatePages(0));
+		if (!level2)
+			return false;
+		Memory::zeroPages(level2, 1);
+
+		for (size_t entry = 0; entry < LEVEL2_ENTRIES_USED; ++entry) {
+			const uintptr_t base = entry * LEVEL2_BLOCK_SIZE;
+			if (isUniform(base, base + LEVEL2_BLOCK_SIZE)) {
+				level2[entry] = describeBlock(base);
+				stats.blocks += level2[entry] != 0;
+				continue;
+			}
+
+			uint64_t *level3 = createLevel3(base);
+			if (!level3) {
+				release();
+				return false;
+			}
+
+			Level2Descriptor descriptor {};
+			descriptor.table.value11 = 3;
+			descriptor.table.tableAddress = reinterpret_cast<uintptr_t>(level3) >> 16;
+			level2[entry] = descriptor.value;
+			++stats.tables;
+		}
+
+		dataSyncBarrier();
+		return true;
+	}
+
+	uint64_t * TranslationTable::findPage(uintptr_t address, bool create) {
+		const size_t index = address / LEVEL2_BLOCK_SIZE;
+		if (!level2 || LEVEL2_ENTRIES_USED <= index)
+			return nullptr;
+
+		Level2Descriptor descriptor;
+		descriptor.value = level2[index];
+		if (descriptor.value == 0) {
+			if (!create)
+				return nullptr;
+
+			uint64_t *table = static_cast<uint64_t *>(Memory::allocatePages(0));
+			if (!table)
+				return nullptr;
+			Memory::zeroPages(table, 1);
+			// The table has to be visible to the walker before anything points to it. Invalid entries are never
+			// cached in the TLB, so nothing needs invalidating.
+			dataSyncBarrier();
+
+			descriptor.table.value11 = 3;
+			descriptor.table.tableAddress = reinterpret_cast<uintptr_t>(table) >> 16;
+			level2[index] = descriptor.value;
+			++stats.tables;
+		} else if (descriptor.table.value11 != 3)
+			return nullptr;
+
+		uint64_t *table = reinterpret_cast<uint64_t *>(static_cast<uintptr_t>(descriptor.table.tableAddress) << 16);
+		return &table[address / LEVEL3_PAGE_SIZE % TABLE_ENTRIES];
+	}
+
+	bool TranslationTable::mapPage(uintptr_t virtual_address, uintptr_t physical_address) {
+		uint64_t *entry = findPage(virtual_address, true);
+		if (!entry || *entry)
+			return false;
+
+		Level3Descriptor descriptor {};
+		descriptor.page.value11 = 3;
+		descriptor.page.outputAddress = physical_address >> 16;
+		setAttributes(descriptor.page, Kind::Normal, false);
+		*entry = descriptor.value;
+		dataSyncBarrier();
+		instructionSyncBarrier();
+		++stats.pages;
+		return true;
+	}
+
+	uintptr_t TranslationTable::unmapPage(uintptr_t virtual_address) {
+		uint64_t *entry = findPage(virtual_address, false);
+		if (!entry || !*entry)
+			return 0;
+
+		Level3Descriptor descriptor;
+		descriptor.value = *entry;
+		// Part of a contiguous run can't be unmapped on its own.
+		assert(!descriptor.page.continous);
+		*entry = 0;
+		asm volatile("dsb ishst; tlbi vaae1is, %0; dsb ish; isb" :: "r"(virtual_address >> 12) : "memory");
+		--stats.pages;
+		return static_cast<uintptr_t>(descriptor.page.outputAddress) << 16;
+	}
+}
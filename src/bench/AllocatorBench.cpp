@@ -0,0 +1,145 @@
+#include "Memory.h"
+#include "bench/AllocatorBench.h"
+
+namespace Armaz::Bench {
+	namespace {
+		constexpr size_t SLOTS = 1024;
+		constexpr size_t WINDOW = 32;
+
+		void *slots[SLOTS];
+		void *window[WINDOW];
+
+		/** xorshift64, so that every run sees the same sequence of requests. */
+		class Random {
+			private:
+				uint64_t state = 0x9e3779b97f4a7c15ul;
+
+			public:
+				uint64_t operator()() {
+					state ^= state << 13;
+					state ^= state >> 7;
+					state ^= state << 17;
+					return state;
+				}
+
+				size_t range(size_t low, size_t high) {
+					return low + (*this)() % (high - low + 1);
+				}
+		};
+
+		inline void * allocate(Memory::Allocator &heap, size_t size, size_t &operations) {
+			++operations;
+			char *ptr = static_cast<char *>(heap.allocate(size));
+			if (ptr)
+				*ptr = 1;
+			return ptr;
+		}
+
+		inline void release(Memory::Allocator &heap, void *&ptr, size_t &operations) {
+			if (ptr) {
+				++operations;
+				heap.free(ptr);
+				ptr = nullptr;
+			}
+		}
+
+		/** Frees every slot in an array, returning the fragmentation seen before the first free. */
+		double teardown(Memory::Allocator &heap, void **array, size_t count, size_t &operations) {
+			const double fragmentation = heap.getFragmentation();
+			for (size_t i = 0; i < count; ++i)
+				release(heap, array[i], operations);
+			return fragmentation;
+		}
+
+		/** Random allocations of 16 to 256 bytes and random frees over a fixed set of slots. */
+		double uniformSmall(Memory::Allocator &heap, size_t target, size_t &operations) {
+			Random random;
+			while (operations < target) {
+				void *&slot = slots[random() % SLOTS];
+				if (slot)
+					release(heap, slot, operations);
+				else
+					slot = allocate(heap, random.range(16, 256), operations);
+			}
+			return teardown(heap, slots, SLOTS, operations);
+		}
+
+		/** Mostly small blocks with one in ten between 4 and 64 KiB. */
+		double bimodal(Memory::Allocator &heap, size_t target, size_t &operations) {
+			Random random;
+			while (operations < target) {
+				void *&slot = slots[random() % (SLOTS / 2)];
+				if (slot)
+					release(heap, slot, operations);
+				else
+					slot = allocate(heap, random() % 10? random.range(16, 128) : random.range(4096, 65536), operations);
+			}
+			return teardown(heap, slots, SLOTS / 2, operations);
+		}
+
+		/** Bursts of allocations followed by bursts of frees in FIFO order, as when buffers are handed from a
+		 *  producer to a consumer. */
+		double producerConsumer(Memory::Allocator &heap, size_t target, size_t &operations) {
+			Random random;
+			size_t head = 0, count = 0;
+			while (operations < target) {
+				for (size_t burst = random.range(1, 64); burst && count < SLOTS; --burst, ++count)
+					slots[(head + count) % SLOTS] = allocate(heap, random.range(32, 512), operations);
+				for (size_t burst = random.range(1, 64); burst && count; --burst, --count) {
+					release(heap, slots[head], operations);
+					head = (head + 1) % SLOTS;
+				}
+			}
+			return teardown(heap, slots, SLOTS, operations);
+		}
+
+		/** Short-lived blocks that die within a small window, interleaved with long-lived blocks of up to 4 KiB that
+		 *  pin down the memory around them. */
+		double longLivedChurn(Memory::Allocator &heap, size_t target, size_t &operations) {
+			Random random;
+			for (size_t step = 0; operations < target; ++step) {
+				void *&churn = window[step % WINDOW];
+				release(heap, churn, operations);
+				churn = allocate(heap, random.range(16, 1024), operations);
+
+				if (step % 16 == 0) {
+					void *&slot = slots[random() % SLOTS];
+					release(heap, slot, operations);
+					slot = allocate(heap, random.range(64, 4096), operations);
+				}
+			}
+			const double fragmentation = teardown(heap, slots, SLOTS, operations);
+			teardown(heap, window, WINDOW, operations);
+			return fragmentation;
+		}
+
+		struct Workload {
+			const char *name;
+			double (*run)(Memory::Allocator &, size_t, size_t &);
+		};
+
+		const Workload workloads[ALLOCATOR_WORKLOADS] = {
+			{"uniform small",     uniformSmall},
+			{"bimodal",           bimodal},
+			{"producer/consumer", producerConsumer},
+			{"long-lived churn",  longLivedChurn},
+		};
+	}
+
+	void benchAllocator(char *region, size_t size, size_t operations, uint64_t (*now)(), AllocatorResult *results) {
+		for (size_t i = 0; i < ALLOCATOR_WORKLOADS; ++i) {
+			Memory::Allocator heap(region, region + size - 1, false);
+			heap.setBounds(region, region + size - 1);
+
+			AllocatorResult &result = results[i];
+			result.name = workloads[i].name;
+			result.operations = 0;
+
+			const uint64_t start = now();
+			result.fragmentation = workloads[i].run(heap, operations, result.operations);
+			result.nanoseconds = now() - start;
+			result.peakLive = heap.getStats().peak;
+			result.footprint = heap.getReserved();
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#include <string.h>
+
+#include "bench/MemoryBench.h"
+
+namespace Armaz::Bench {
+	namespace {
+		/** Each measurement makes enough calls to process about this many bytes. */
+		constexpr size_t BYTES_PER_MEASUREMENT = 4 << 20;
+		constexpr size_t MIN_CALLS = 64;
+
+		// Calling through volatile pointers keeps the compiler from inlining or eliding any of the calls.
+		void * (* volatile copy)(void *, const void *, size_t) = memcpy;
+		void * (* volatile move)(void *, const void *, size_t) = memmove;
+		void * (* volatile set)(void *, int, size_t) = memset;
+		int (* volatile compare)(const void *, const void *, size_t) = memcmp;
+
+		enum class Function {Memcpy, Memmove, Memset, Memcmp};
+
+		double measure(Function function, char *first, char *second, size_t size, const MemoryAlignment &alignment,
+		               uint64_t (*now)()) {
+			char *source = first + alignment.source;
+			char *destination = second + alignment.destination;
+			if (function == Function::Memmove)
+				destination = first + 64 + alignment.destination;
+			else if (function == Function::Memcmp)
+				copy(destination, source, size);
+
+			const size_t calls = MIN_CALLS < BYTES_PER_MEASUREMENT / size? BYTES_PER_MEASUREMENT / size : MIN_CALLS;
+			uint64_t start = 0;
+
+			// The first call is untimed so that the caches and branch predictors are warm.
+			switch (function) {
+				case Function::Memcpy:
+					copy(destination, source, size);
+					start = now();
+					for (size_t i = 0; i < calls; ++i)
+						copy(destination, source, size);
+					break;
+				case Function::Memmove:
+					move(destination, source, size);
+					start = now();
+					for (size_t i = 0; i < calls; ++i)
+						move(destination, source, size);
+					break;
+				case Function::Memset:
+					set(destination, 0, size);
+					start = now();
+					for (size_t i = 0; i < calls; ++i)
+						set(destination, 0, size);
+					break;
+				case Function::Memcmp:
+					compare(destination, source, size);
+					start = now();
+					for (size_t i = 0; i < calls; ++i)
+						compare(destination, source, size);
+					break;
+			}
+
+			const uint64_t elapsed = now() - start;
+			return elapsed? static_cast<double>(calls * size) / elapsed : 0.;
+		}
+	}
+
+	void benchMemory(char *region, size_t max_size, uint64_t (*now)(), void (*report)(const MemoryRow &)) {
+		constexpr const char *names[] {"memcpy", "memmove", "memset", "memcmp"};
+		constexpr Function functions[] {Function::Memcpy, Function::Memmove, Function::Memset, Function::Memcmp};
+
+		if (MEMORY_MAX_SIZE < max_size)
+			max_size = MEMORY_MAX_SIZE;
+
+		char *first = region;
+		char *second = region + MEMORY_MAX_SIZE + 128;
+		for (size_t i = 0; i < MEMORY_MAX_SIZE + 128; ++i)
+			first[i] = static_cast<char>(i * 7 + 1);
+
+		for (size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); ++f)
+			for (size_t size = 1; size <= max_size; size *= 2) {
+				MemoryRow row {names[f], size, {}};
+				for (size_t a = 0; a < MEMORY_ALIGNMENTS; ++a)
+					row.bytesPerTick[a] = measure(functions[f], first, second, size, memoryAlignments[a], now);
+				report(row);
+			}
+	}
+}
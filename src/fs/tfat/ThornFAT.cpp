@@ -4,6 +4,7 @@
 
 #include "Kernel.h"
 #include "Memory.h"
+#include "Zone.h"
 #include "util.h"
 #include "aarch64/Timer.h"
 #include "fs/tfat/ThornFAT.h"
@@ -1070,18 +1071,27 @@ namespace Armaz::ThornFAT {
 		size_t position = block_size;
 		size_t remaining = table_size * block_size;
 		static char zeros[512] = {};
+		// A zeroed page lets the table go out in far fewer writes. The small static buffer is the fallback.
+		char *page = static_cast<char *>(Memory::allocatePages(0));
+		if (page)
+			Memory::zeroPages(page, 1);
+		const char *buffer = page? page : zeros;
+		const size_t chunk = page? PAGE_SIZE : sizeof(zeros);
 		ssize_t status;
-		while (512 <= remaining) {
-			if ((status = partition->write(zeros, 512, position)) < 0) {
+		while (chunk <= remaining) {
+			if ((status = partition->write(buffer, chunk, position)) < 0) {
 				DBGN("initFAT", "Failed to write. Status:", status);
+				free(page);
 				return false;
 			}
-			position += 512;
-			remaining -= 512;
+			position += chunk;
+			remaining -= chunk;
 			DBGN("initFAT", "Remaining:", remaining);
 		}
 
-		if ((status = partition->write(zeros, remaining, position)) < 0) {
+		status = partition->write(buffer, remaining, position);
+		free(page);
+		if (status < 0) {
 			DBGN("initFAT", "Failed to write. Status:", status);
 			return false;
 		}
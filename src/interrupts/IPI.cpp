@@ -0,0 +1,110 @@
+#include "aarch64/ARM.h"
+#include "aarch64/Spinlock.h"
+#include "aarch64/Synchronize.h"
+#include "interrupts/IPI.h"
+#include "interrupts/IRQ.h"
+
+namespace Armaz::IPI {
+	namespace {
+		struct alignas(L1_DATA_CACHE_LINE_LENGTH) CallSlot {
+			bool pending = false;
+			Cores::Work function = nullptr;
+			void *argument = nullptr;
+		};
+
+		CallSlot callSlots[CORES];
+		void (*rescheduleHandler)() = nullptr;
+
+		/** Shootdowns wait for acknowledgements from other cores, so they're serialized without masking IRQs:
+		 *  another core spinning here has to be able to acknowledge the shootdown in progress. */
+		Spinlock shootdownLock {Level::Task};
+		unsigned shootdownAcknowledgements = 0;
+
+		void flushTLB() {
+			asm volatile("dsb ishst; tlbi vmalle1; dsb ish; isb" ::: "memory");
+		}
+	}
+
+	void send(unsigned core, Message message) {
+		Interrupts::sendSGI(static_cast<unsigned>(message), 1 << core);
+	}
+
+	void broadcast(Message message) {
+		Interrupts::sendSGIToOthers(static_cast<unsigned>(message));
+	}
+
+	void handle(unsigned sgi) {
+		switch (static_cast<Message>(sgi)) {
+			case Message::Reschedule:
+				if (rescheduleHandler)
+					rescheduleHandler();
+				break;
+
+			case Message::TLBShootdown:
+				flushTLB();
+				__atomic_add_fetch(&shootdownAcknowledgements, 1, __ATOMIC_RELEASE);
+				break;
+
+			case Message::Call: {
+				CallSlot &slot = callSlots[ARM::getCore()];
+				if (__atomic_load_n(&slot.pending, __ATOMIC_ACQUIRE)) {
+					slot.function(slot.argument);
+					__atomic_store_n(&slot.pending, false, __ATOMIC_RELEASE);
+				}
+				break;
+			}
+
+			case Message::Halt:
+				Interrupts::disableBoth();
+				for (;;)
+					asm volatile("wfi");
+
+			default:
+				break;
+		}
+	}
+
+	void setRescheduleHandler(void (*handler)()) {
+		rescheduleHandler = handler;
+	}
+
+	bool call(unsigned core, Cores::Work function, void *argument, bool wait) {
+		if (core == ARM::getCore()) {
+			function(argument);
+			return true;
+		}
+
+		if (!Cores::isOnline(core))
+			return false;
+
+		CallSlot &slot = callSlots[core];
+		bool expected = false;
+		while (!__atomic_compare_exchange_n(&slot.pending, &expected, true, false, __ATOMIC_ACQUIRE,
+		       __ATOMIC_RELAXED))
+			expected = false;
+
+		slot.function = function;
+		slot.argument = argument;
+		dataSyncBarrier();
+		send(core, Message::Call);
+
+		// Once pending is clear, another caller may already have claimed the slot again, which only means waiting a
+		// little longer.
+		if (wait)
+			while (__atomic_load_n(&slot.pending, __ATOMIC_ACQUIRE));
+		return true;
+	}
+
+	void shootdownTLBs() {
+		shootdownLock.acquire();
+		__atomic_store_n(&shootdownAcknowledgements, 0, __ATOMIC_RELAXED);
+		const unsigned online = Cores::getOnlineCount();
+		const unsigned others = online? online - 1 : 0;
+		dataSyncBarrier();
+		if (others)
+			broadcast(Message::TLBShootdown);
+		flushTLB();
+		while (__atomic_load_n(&shootdownAcknowledgements, __ATOMIC_ACQUIRE) < others);
+		shootdownLock.release();
+	}
+}
@@ -2,10 +2,13 @@
 
 #include "assert.h"
 #include "Config.h"
+#include "Kernel.h"
+#include "Pager.h"
 #include "aarch64/MMIO.h"
 #include "aarch64/Synchronize.h"
 #include "board/BCM2711.h"
 #include "board/BCM2711int.h"
+#include "interrupts/IPI.h"
 #include "interrupts/IRQ.h"
 #include "lib/printf.h"
 #include "pi/GPIO.h"
@@ -39,6 +42,8 @@
 	#define GICD_SGIR_SGIINTID__MASK		0x0F
 	#define GICD_SGIR_CPU_TARGET_LIST__SHIFT	16
 	#define GICD_SGIR_TARGET_LIST_FILTER__SHIFT	24
+		#define GICD_SGIR_FILTER_LIST	0
+		#define GICD_SGIR_FILTER_OTHERS	1
 
 // GIC CPU interface registers
 #define GICC_CTLR		(ARM_GICC_BASE + 0x000)
@@ -59,6 +64,18 @@
 	#define GICC_EOIR_CPUID__SHIFT		10
 	#define GICC_EOIR_CPUID__MASK		(3 << 10)
 
+// Exception syndrome register
+#define ESR_EC__SHIFT			26
+#define ESR_EC__MASK			0x3F
+	#define ESR_EC_DATA_ABORT_SAME_EL	0x25
+#define ESR_ISS_FNV			(1 << 10)	// FAR isn't valid
+#define ESR_DFSC_TRANSLATION__MASK	0x3C
+	#define ESR_DFSC_TRANSLATION	0x04	// translation fault at any level
+
+// Saved program status register
+#define SPSR_DAIF__MASK			0x3C0
+	#define SPSR_I			(1 << 7)
+
 namespace Armaz::Interrupts {
 	Handler handlers[72];
 	void *params[72];
@@ -96,11 +113,37 @@ namespace Armaz::Interrupts {
 
 		write32(GICD_CTLR, GICD_CTLR_ENABLE);
 
-		// Initialize core 0 CPU interface
+		initCore();
+	}
+
+	void initCore() {
+		// SGIs and PPIs (0-31) are banked, so every core has to reset its own.
+		write32(GICD_ICENABLER0, ~0);
+		write32(GICD_ICPENDR0,   ~0);
+		write32(GICD_ICACTIVER0, ~0);
+		write32(GICD_ISENABLER0, (1 << IPI::MESSAGES) - 1);
+		for (int n = 0; n < 32 / 4; ++n)
+			write32(GICD_IPRIORITYR0 + 4 * n, GICD_IPRIORITYR_DEFAULT
+				| GICD_IPRIORITYR_DEFAULT << 8 | GICD_IPRIORITYR_DEFAULT << 16 | GICD_IPRIORITYR_DEFAULT << 24);
+
 		write32(GICC_PMR, GICC_PMR_PRIORITY);
 		write32(GICC_CTLR, GICC_CTLR_ENABLE);
 
-		enableIRQs();
+		// Nothing is routed to FIQ, but the multi-core critical sections expect FIQs to be unmasked outside of them.
+		enableBoth();
+	}
+
+	void sendSGI(unsigned sgi, unsigned cores) {
+		assert(sgi <= GICD_SGIR_SGIINTID__MASK);
+		dataSyncBarrier();
+		write32(GICD_SGIR, GICD_SGIR_FILTER_LIST << GICD_SGIR_TARGET_LIST_FILTER__SHIFT
+			| (cores & 0xff) << GICD_SGIR_CPU_TARGET_LIST__SHIFT | sgi);
+	}
+
+	void sendSGIToOthers(unsigned sgi) {
+		assert(sgi <= GICD_SGIR_SGIINTID__MASK);
+		dataSyncBarrier();
+		write32(GICD_SGIR, GICD_SGIR_FILTER_OTHERS << GICD_SGIR_TARGET_LIST_FILTER__SHIFT | sgi);
 	}
 
 	void connect(unsigned irq, Handler handler, void *param) {
@@ -145,6 +188,21 @@ namespace Armaz::Interrupts {
 		printf("SecureMonitorHandler(%u, %u)\n", function, param);
 	}
 
+	bool SynchronousHandler(uint64_t esr, uint64_t far) {
+		if ((esr >> ESR_EC__SHIFT & ESR_EC__MASK) != ESR_EC_DATA_ABORT_SAME_EL || (esr & ESR_ISS_FNV)
+		    || (esr & ESR_DFSC_TRANSLATION__MASK) != ESR_DFSC_TRANSLATION)
+			return false;
+
+		// The pager takes spinlocks, which expect the FIQ mask of the code that faulted rather than the exception's.
+		// IRQs stay masked so that nothing can overwrite ELR_EL1 and SPSR_EL1 before the return.
+		uint64_t spsr;
+		asm volatile("mrs %0, spsr_el1" : "=r"(spsr));
+		asm volatile("msr daif, %0" :: "r"((spsr & SPSR_DAIF__MASK) | SPSR_I));
+		const bool resolved = Kernel::getPager().handleFault(far);
+		asm volatile("msr daifset, #0xf");
+		return resolved;
+	}
+
 	static uint64_t eh_regs[32];
 
 	void ExceptionHandler(uint64_t exception, AbortFrame *frame) {
@@ -223,7 +281,10 @@ namespace Armaz::Interrupts {
 			}
 #ifdef ARM_ALLOW_MULTI_CORE
 			else {
-				// TODO
+				// Some IPIs never return here (halting, for one), so they're acknowledged first.
+				write32(GICC_EOIR, iar);
+				IPI::handle(irq);
+				return;
 			}
 #endif
 			write32(GICC_EOIR, iar);
@@ -1,9 +1,13 @@
 #include "assert.h"
 #include "Log.h"
 #include "Memory.h"
+#include "Scheduler.h"
 #include "Test.h"
+#include "Zone.h"
 #include "aarch64/ARM.h"
+#include "aarch64/Cores.h"
 #include "aarch64/MMIO.h"
+#include "aarch64/MMU.h"
 #include "aarch64/Timer.h"
 #include "aarch64/Synchronize.h"
 #include "board/BCM2836.h"
@@ -48,9 +52,19 @@ extern "C" void main() {
 	printf("Hello, world!\n");
 
 	Memory::Allocator memory;
-	memory.setBounds((char *) MEM_HIGHMEM_START, (char *) MEM_HIGHMEM_END);
+	Memory::Allocator dma_memory(nullptr, nullptr, false);
+	if (!Memory::initZones(memory, dma_memory))
+		Log::error("Couldn't set up the memory zones.");
+	else if (!MMU::init(Memory::getRAMEnd()))
+		Log::error("Couldn't build the translation tables; running with caches off.");
 
-	// Timers::timer.init();
+	Timers::initScales();
+	if (const unsigned cores = Cores::start(); cores < CORES)
+		Log::warn("Only %u of %u cores are online.", cores, CORES);
+
+	if (!Scheduler::get()->init())
+		Log::error("Couldn't start the scheduler.");
+	Timers::getTimer().init();
 
 	PropertyTagMemory mem;
 	if (PropertyTags::getTag(PROPTAG_GET_ARM_MEMORY, &mem, sizeof(mem))) {
@@ -132,11 +146,11 @@ extern "C" void main() {
 			}
 		}
 
-		asm volatile("wfi");
+		if (!Scheduler::get()->yield())
+			asm volatile("wfi");
 	}
 }
 
 extern "C" void main_secondary() {
-	printf("main_secondary unimplemented!\n");
-	for (;;) asm volatile("wfi");
+	Cores::runSecondary();
 }
@@ -2,8 +2,13 @@
 #include <stdint.h>
 
 #include "util.h"
+#include "aarch64/MMU.h"
 
-extern "C" void * memcpy(void *dest, const void *src, size_t n) {
+extern "C" void * memcpy_neon(void *dest, const void *src, size_t n);
+
+/** Never makes an unaligned access, so this is what runs while the MMU is off and all memory is treated as device
+ *  memory. */
+static void * memcpy_careful(void *dest, const void *src, size_t n) {
 	uintptr_t destp = reinterpret_cast<uintptr_t>(dest);
 	uintptr_t srcp  = reinterpret_cast<uintptr_t>(src);
 	char *destc = reinterpret_cast<char *>(dest);
@@ -63,3 +68,9 @@ extern "C" void * memcpy(void *dest, const void *src, size_t n) {
 	
 	return dest;
 }
+
+extern "C" void * memcpy(void *dest, const void *src, size_t n) {
+	if (Armaz::MMU::enabled)
+		return memcpy_neon(dest, src, n);
+	return memcpy_careful(dest, src, n);
+}
@@ -1,6 +1,12 @@
 #include "util.h"
+#include "aarch64/MMU.h"
+
+extern "C" void * memmove_neon(void *dest, const void *src, size_t n);
 
 extern "C" void * memmove(void *dest, const void *src, size_t n) {
+	if (Armaz::MMU::enabled)
+		return memmove_neon(dest, src, n);
+
 	if (reinterpret_cast<uintptr_t>(dest) < reinterpret_cast<uintptr_t>(src))
 		return memcpy(dest, src, n);
 	
@@ -21,11 +21,17 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "Memory.h"
+#include "aarch64/MMU.h"
+
 #define CAREFUL_MEMSET
 
 using op_t = unsigned long long int;
 
-extern "C" void * memset(void *dstpp, int c, size_t len) {
+extern "C" void * memset_neon(void *dest, int c, size_t len);
+
+/** Only makes aligned stores, so this is what runs while the MMU is off. */
+static void * memset_careful(void *dstpp, int c, size_t len) {
 #ifdef CAREFUL_MEMSET
 	char *dest = reinterpret_cast<char *>(dstpp);
 	while (reinterpret_cast<uintptr_t>(dest) % 8 && len) {
@@ -105,4 +111,16 @@ extern "C" void * memset(void *dstpp, int c, size_t len) {
 	}
 #endif
 	return dstpp;
-}
\ No newline at end of file
+}
+
+extern "C" void * memset(void *dest, int c, size_t len) {
+	if (Armaz::MMU::enabled)
+		return memset_neon(dest, c, len);
+	return memset_careful(dest, c, len);
+}
+
+namespace Armaz::Memory {
+	void zeroPages(void *pages, size_t count) {
+		memset(pages, 0, count * PAGE_SIZE);
+	}
+}
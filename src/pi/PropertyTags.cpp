@@ -3,7 +3,6 @@
 #include <string.h>
 
 #include "assert.h"
-#include "Memory.h"
 #include "util.h"
 #include "aarch64/Synchronize.h"
 #include "board/BCM2835.h"
@@ -18,6 +17,10 @@ namespace Armaz::PropertyTags {
 		uint8_t  tags[0];
 	} __attribute__((packed));
 
+	/** The buffer handed to the VideoCore. It's in the kernel's .bss, which is always below 1 GiB where the VideoCore
+	 *  can reach it, and occupies whole cache lines so that maintaining it can't disturb anything else. */
+	alignas(L1_DATA_CACHE_LINE_LENGTH) static uint8_t propertyStorage[1024];
+
 	constexpr uint32_t CODE_REQUEST          = 0x00000000;
 	constexpr uint32_t CODE_RESPONSE_SUCCESS = 0x80000000;
 	// constexpr uint32_t CODE_RESPONSE_FAILURE = 0x80000001;
@@ -43,8 +46,9 @@ namespace Armaz::PropertyTags {
 		assert(sizeof(PropertyTag) + sizeof(uint32_t) <= tags_size);
 		uint32_t buffer_size = sizeof(PropertyBuffer) + tags_size + sizeof(uint32_t);
 		assert((buffer_size & 3) == 0);
+		assert(buffer_size <= sizeof(propertyStorage));
 
-		PropertyBuffer *buffer = reinterpret_cast<PropertyBuffer *>(Memory::getCoherentPage(Memory::SLOT_PROP_MAILBOX));
+		PropertyBuffer *buffer = reinterpret_cast<PropertyBuffer *>(propertyStorage);
 		buffer->bufferSize = buffer_size;
 		buffer->code = CODE_REQUEST;
 		memcpy(buffer->tags, tags, tags_size);
@@ -52,13 +56,13 @@ namespace Armaz::PropertyTags {
 		uint32_t *end_tag = reinterpret_cast<uint32_t *>(buffer->tags + tags_size);
 		*end_tag = PROPTAG_END;
 
-		dataSyncBarrier();
+		cleanRange(buffer, buffer_size);
 
 		uint32_t buffer_address = BUS_ADDRESS((uintptr_t) buffer);
 		if (Mailbox::writeRead(CHANNEL_OUT, buffer_address) != buffer_address)
 			return false;
 
-		dataMemBarrier();
+		invalidateRange(buffer, buffer_size);
 
 		if (buffer->code != CODE_RESPONSE_SUCCESS)
 			return false;
@@ -77,9 +77,9 @@ namespace Armaz::UART {
 	};
 
 #ifdef UART_USE_FIQ
-	static Spinlock spinlock {Level::FIQ};
+	static TicketLock spinlock {Level::FIQ, "uart"};
 #else
-	static Spinlock spinlock {Level::IRQ};
+	static TicketLock spinlock {Level::IRQ, "uart"};
 #endif
 	static Spinlock lineSpinlock {Level::Task};
 
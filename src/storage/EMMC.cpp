@@ -38,6 +38,9 @@
 
 #include "assert.h"
 #include "Log.h"
+#include "Memory.h"
+#include "Scheduler.h"
+#include "Zone.h"
 #include "util.h"
 #include "aarch64/MMIO.h"
 #include "aarch64/Synchronize.h"
@@ -77,6 +80,9 @@
 // Enable 4-bit support
 #define SD_4BIT_DATA
 
+// Let other threads run while waiting for the controller
+#define NO_BUSY_WAIT
+
 // SD Clock Frequencies (in Hz)
 #define SD_CLOCK_ID         400'000
 #define SD_CLOCK_NORMAL  25'000'000
@@ -479,9 +485,6 @@ namespace Armaz {
 #endif
 		sdConfig(nullptr) {
 
-		sdConfig = new SDConfiguration;
-		assert(sdConfig);
-
 #ifndef USE_SDHOST
 
 #if RASPPI == 3
@@ -505,13 +508,21 @@ namespace Armaz {
 #ifdef USE_SDHOST
 		host.reset();
 #endif
-		delete sdConfig;
+		free(sdConfig);
 	}
 
 	bool EMMCDevice::init() {
 		if (initialized)
 			return false;
 
+		// The SCR is read into sdConfig by a data transfer, so it has to be DMA-safe. This can't happen in the
+		// constructor because EMMCDevices can be constructed before the memory zones are set up.
+		if (!sdConfig) {
+			void *config = Memory::allocateDMA(sizeof(SDConfiguration));
+			assert(config);
+			sdConfig = new (config) SDConfiguration;
+		}
+
 #ifndef USE_SDHOST
 #if RASPPI >= 4
 		// disable 1.8V supply
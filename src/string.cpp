@@ -0,0 +1,81 @@
+// These replace musl's generic C versions: the kernel's objects come before libc.a on the link line, so the linker
+// never pulls in musl's copies. The assembly versions make unaligned loads, so simple byte loops are used until the
+// MMU is enabled.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aarch64/MMU.h"
+
+extern "C" {
+	int memcmp_word(const void *, const void *, size_t);
+	void * memchr_neon(const void *, int, size_t);
+	size_t strlen_neon(const char *);
+	int strcmp_word(const char *, const char *);
+	int strncmp_word(const char *, const char *, size_t);
+}
+
+static int memcmp_careful(const void *left, const void *right, size_t n) {
+	const unsigned char *l = reinterpret_cast<const unsigned char *>(left);
+	const unsigned char *r = reinterpret_cast<const unsigned char *>(right);
+	for (; n && *l == *r; --n, ++l, ++r);
+	return n? *l - *r : 0;
+}
+
+static void * memchr_careful(const void *src, int c, size_t n) {
+	const unsigned char *s = reinterpret_cast<const unsigned char *>(src);
+	for (; n && *s != static_cast<unsigned char>(c); --n, ++s);
+	return n? const_cast<unsigned char *>(s) : nullptr;
+}
+
+static size_t strlen_careful(const char *s) {
+	const char *start = s;
+	for (; *s; ++s);
+	return s - start;
+}
+
+static int strcmp_careful(const char *left, const char *right) {
+	const unsigned char *l = reinterpret_cast<const unsigned char *>(left);
+	const unsigned char *r = reinterpret_cast<const unsigned char *>(right);
+	for (; *l == *r && *l; ++l, ++r);
+	return *l - *r;
+}
+
+static int strncmp_careful(const char *left, const char *right, size_t n) {
+	const unsigned char *l = reinterpret_cast<const unsigned char *>(left);
+	const unsigned char *r = reinterpret_cast<const unsigned char *>(right);
+	if (n-- == 0)
+		return 0;
+	for (; *l && *r && n && *l == *r; ++l, ++r, --n);
+	return *l - *r;
+}
+
+extern "C" int memcmp(const void *left, const void *right, size_t n) {
+	if (Armaz::MMU::enabled)
+		return memcmp_word(left, right, n);
+	return memcmp_careful(left, right, n);
+}
+
+extern "C" void * memchr(const void *src, int c, size_t n) {
+	if (Armaz::MMU::enabled)
+		return memchr_neon(src, c, n);
+	return memchr_careful(src, c, n);
+}
+
+extern "C" size_t strlen(const char *s) {
+	if (Armaz::MMU::enabled)
+		return strlen_neon(s);
+	return strlen_careful(s);
+}
+
+extern "C" int strcmp(const char *left, const char *right) {
+	if (Armaz::MMU::enabled)
+		return strcmp_word(left, right);
+	return strcmp_careful(left, right);
+}
+
+extern "C" int strncmp(const char *left, const char *right, size_t n) {
+	if (Armaz::MMU::enabled)
+		return strncmp_word(left, right, n);
+	return strncmp_careful(left, right, n);
+}